@@ -0,0 +1,563 @@
+/*
+ ******************************************************************************
+ * @file    config_store.c
+ * @brief   Persistent configuration, key/value records in emulated EEPROM
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * The values live in a RAM mirror, each with the '#' of its reply: a read is
+ * a pointer, the LX200 get commands never touch the flash.
+ *
+ * The two flash pages at CONFIG_FLASH_ADDRESS take turns. The active page is
+ * a log of fixed size records, a change is appended and the last record of a
+ * key wins. When the page is full the current values are transferred to the
+ * other page and the full one is erased, so both pages wear evenly.
+ *
+ *   page:   state, generation, record, record, ...
+ *   record: key | length << 8, CONFIG_VALUE_MAX_LEN value bytes, checksum
+ *
+ * Page states: erased 0xFFFF -> receive 0xEEEE -> valid 0x0000. A record is
+ * programmed value first, its key last: a record cut by a reset has no key
+ * and is skipped, a transfer cut by a reset is finished or dropped by
+ * config_init().
+ *
+ * The core stalls while the flash is erased or programmed, interrupts
+ * included. Changes are therefore written by a scheduler task, CONFIG_WRITE_DELAY_MS
+ * after the last change and only while no USB data came in for CONFIG_QUIET_MS,
+ * no guide pulse is active and no mount reply is pending.
+ *
+ * :XC# reply:
+ *   "<latitude>,<longitude>,<rate>,<generation>,<used bytes>,<writes>,<deferred>,<errors>,<pending>,<site name>#"
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+#include "config_store.h"
+#include "scheduler.h"
+#include "event_loop.h"
+#include "st4_handler.h"
+#include "mount_reply.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define CONFIG_PAGES            2
+#define CONFIG_HEADER_SIZE      4       // state, generation
+#define CONFIG_RECORD_SIZE      (2 + CONFIG_VALUE_MAX_LEN + 2)
+#define CONFIG_CHECKSUM_OFFSET  (2 + CONFIG_VALUE_MAX_LEN)
+
+#define CONFIG_PAGE_ERASED      0xFFFFU
+#define CONFIG_PAGE_RECEIVE     0xEEEEU
+#define CONFIG_PAGE_VALID       0x0000U
+
+#define CONFIG_ALL_KEYS         ((1U << CONFIG_KEYS) - 1U)
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    char text[CONFIG_VALUE_MAX_LEN + 2];    // value and '#', the reply
+    uint8_t length;                         // of the value
+} config_value_t;
+
+typedef struct {
+    const char* value;                      // default
+    const char* const* formats;             // accepted forms, NULL for any text
+} config_key_def_t;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTION PROTOTYPES
+ * ============================================================================ */
+static void config_write(void* context);
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+/* format characters: 's' sign, '9' digit, '*' degree sign, others as they are */
+static const char* const config_latitude_formats[] = { "s99*99", "s99*99:99", NULL };
+static const char* const config_longitude_formats[] = { "999*99", "999*99:99", "s999*99", "s999*99:99", NULL };
+static const char* const config_rate_formats[] = { "99.9", NULL };
+
+/* defaults are the values the proxy answered before the store existed */
+static const config_key_def_t config_keys[CONFIG_KEYS] = {
+    { "LX200 Site",  NULL },
+    { "+47*59:46",   config_latitude_formats },
+    { "+007*51:10",  config_longitude_formats },
+    { "60.1",        config_rate_formats },
+};
+
+static config_value_t config_mirror[CONFIG_KEYS];
+
+static uint8_t config_page = 0;                         // active page
+static uint16_t config_generation = 0;                  // transfers of the device
+static uint16_t config_offset = CONFIG_HEADER_SIZE;     // next free record
+static uint8_t config_dirty = 0;                        // keys not written yet
+
+static uint32_t config_writes = 0;
+static uint32_t config_deferred = 0;
+static uint32_t config_errors = 0;
+
+static const sched_task_t config_task = { "config", config_write, 0, CONFIG_WRITE_BUDGET_US };
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint16_t config_read(uint8_t page, uint16_t offset)
+{
+    return *(const volatile uint16_t*)(CONFIG_FLASH_ADDRESS + page * FLASH_PAGE_SIZE + offset);
+}
+
+/**
+ * @brief Program one halfword, erased halfwords are skipped
+ * @retval 1 if programmed
+ */
+static uint8_t config_program(uint8_t page, uint16_t offset, uint16_t value)
+{
+    if(value == 0xFFFFU)
+    {
+        return 1;
+    }
+    if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, CONFIG_FLASH_ADDRESS + page * FLASH_PAGE_SIZE + offset,
+                         value) != HAL_OK)
+    {
+        config_errors++;
+        return 0;
+    }
+    return 1;
+}
+
+static uint8_t config_erase(uint8_t page)
+{
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .Banks = FLASH_BANK_1,
+        .PageAddress = CONFIG_FLASH_ADDRESS + page * FLASH_PAGE_SIZE,
+        .NbPages = 1,
+    };
+    uint32_t page_error;
+
+    if(HAL_FLASHEx_Erase(&erase, &page_error) != HAL_OK)
+    {
+        config_errors++;
+        return 0;
+    }
+    return 1;
+}
+
+static uint8_t config_erased(uint8_t page, uint16_t offset, uint16_t length)
+{
+    for(uint16_t i = 0; i < length; i += 2)
+    {
+        if(config_read(page, offset + i) != 0xFFFFU)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint16_t config_checksum(uint16_t header, const uint16_t* data)
+{
+    uint16_t sum = header;
+
+    for(uint8_t i = 0; i < CONFIG_VALUE_MAX_LEN / 2; i++)
+    {
+        sum = (uint16_t)(((sum << 1) | (sum >> 15)) + data[i]);
+    }
+    // an all zero record must not be valid
+    return (uint16_t)~sum;
+}
+
+static void config_assign(config_key_t key, const char* value, uint8_t length)
+{
+    config_value_t* mirror = &config_mirror[key];
+
+    memcpy(mirror->text, value, length);
+    mirror->text[length] = '#';
+    mirror->text[length + 1] = '\0';
+    mirror->length = length;
+}
+
+/**
+ * @brief Value matches one of the formats of its key
+ */
+static uint8_t config_valid(config_key_t key, const char* value, uint8_t length)
+{
+    const char* const* formats = config_keys[key].formats;
+
+    if(formats == NULL)
+    {
+        return 1;
+    }
+    for(; *formats != NULL; formats++)
+    {
+        const char* format = *formats;
+        uint8_t n;
+
+        if(strlen(format) != length)
+        {
+            continue;
+        }
+        for(n = 0; n < length; n++)
+        {
+            char c = value[n];
+            uint8_t match = (format[n] == 's') ? ((c == '+') || (c == '-'))
+                          : (format[n] == '9') ? ((c >= '0') && (c <= '9'))
+                          : (c == format[n]);
+
+            if(!match)
+            {
+                break;
+            }
+        }
+        if(n == length)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Walk the records of a page
+ * @param load: copy the values into the mirror
+ * @param end: offset of the first free record
+ * @retval keys found
+ */
+static uint8_t config_scan(uint8_t page, uint8_t load, uint16_t* end)
+{
+    uint8_t found = 0;
+    uint16_t offset;
+
+    for(offset = CONFIG_HEADER_SIZE; offset + CONFIG_RECORD_SIZE <= FLASH_PAGE_SIZE; offset += CONFIG_RECORD_SIZE)
+    {
+        uint16_t header = config_read(page, offset);
+        uint16_t data[CONFIG_VALUE_MAX_LEN / 2];
+
+        if(header == 0xFFFFU)
+        {
+            if(config_erased(page, offset, CONFIG_RECORD_SIZE))
+            {
+                break;
+            }
+            // cut before its key was written, the slot stays unused
+            continue;
+        }
+
+        for(uint8_t i = 0; i < CONFIG_VALUE_MAX_LEN / 2; i++)
+        {
+            data[i] = config_read(page, offset + 2 + 2 * i);
+        }
+
+        config_key_t key = (config_key_t)(header & 0xFFU);
+        uint8_t length = (uint8_t)(header >> 8);
+
+        if((key >= CONFIG_KEYS) || (length > CONFIG_VALUE_MAX_LEN) ||
+           (config_read(page, offset + CONFIG_CHECKSUM_OFFSET) != config_checksum(header, data)))
+        {
+            continue;
+        }
+        found |= (uint8_t)(1U << key);
+        if(load)
+        {
+            char value[CONFIG_VALUE_MAX_LEN];
+
+            for(uint8_t i = 0; i < CONFIG_VALUE_MAX_LEN / 2; i++)
+            {
+                value[2 * i] = (char)(data[i] & 0xFFU);
+                value[2 * i + 1] = (char)(data[i] >> 8);
+            }
+            config_assign(key, value, length);
+        }
+    }
+    *end = offset;
+    return found;
+}
+
+/**
+ * @brief Program the mirror value of a key as record, its key last
+ */
+static uint8_t config_write_record(uint8_t page, uint16_t offset, config_key_t key)
+{
+    const config_value_t* mirror = &config_mirror[key];
+    uint16_t header = (uint16_t)(key | (mirror->length << 8));
+    uint16_t data[CONFIG_VALUE_MAX_LEN / 2];
+
+    for(uint8_t i = 0; i < CONFIG_VALUE_MAX_LEN / 2; i++)
+    {
+        uint8_t low = (2 * i < mirror->length) ? (uint8_t)mirror->text[2 * i] : 0xFFU;
+        uint8_t high = (2 * i + 1 < mirror->length) ? (uint8_t)mirror->text[2 * i + 1] : 0xFFU;
+
+        data[i] = (uint16_t)(low | (high << 8));
+        if(!config_program(page, offset + 2 + 2 * i, data[i]))
+        {
+            return 0;
+        }
+    }
+    if(!config_program(page, offset + CONFIG_CHECKSUM_OFFSET, config_checksum(header, data)) ||
+       !config_program(page, offset, header))
+    {
+        return 0;
+    }
+    config_writes++;
+    return 1;
+}
+
+/**
+ * @brief Move all values to the other page, the active one is erased
+ */
+static uint8_t config_transfer(void)
+{
+    uint8_t target = config_page ^ 1U;
+    uint16_t offset = CONFIG_HEADER_SIZE;
+
+    if(!config_erased(target, 0, FLASH_PAGE_SIZE) && !config_erase(target))
+    {
+        return 0;
+    }
+    if(!config_program(target, 0, CONFIG_PAGE_RECEIVE) ||
+       !config_program(target, 2, (uint16_t)(config_generation + 1U)))
+    {
+        return 0;
+    }
+    for(uint8_t key = 0; key < CONFIG_KEYS; key++)
+    {
+        if(!config_write_record(target, offset, (config_key_t)key))
+        {
+            return 0;
+        }
+        offset += CONFIG_RECORD_SIZE;
+    }
+    if(!config_erase(config_page) || !config_program(target, 0, CONFIG_PAGE_VALID))
+    {
+        return 0;
+    }
+
+    config_page = target;
+    config_generation++;
+    config_offset = offset;
+    config_dirty = 0;
+    return 1;
+}
+
+/**
+ * @brief Write a changed key, a full page is transferred (all keys)
+ */
+static uint8_t config_append(config_key_t key)
+{
+    if(config_offset + CONFIG_RECORD_SIZE > FLASH_PAGE_SIZE)
+    {
+        return config_transfer();
+    }
+
+    // a failed record is skipped by config_scan(), its slot is lost
+    uint8_t written = config_write_record(config_page, config_offset, key);
+
+    config_offset += CONFIG_RECORD_SIZE;
+    if(written)
+    {
+        config_dirty &= (uint8_t)~(1U << key);
+    }
+    return written;
+}
+
+/**
+ * @brief Nothing that would suffer from the stalled core: client, guide pulses, mount reply
+ */
+static uint8_t config_quiet(void)
+{
+    return (event_usb_idle_ms() >= CONFIG_QUIET_MS) && !st4_busy() && (mount_reply_pending() == 0);
+}
+
+/**
+ * @brief Write the changed keys, one-shot task started by config_set()
+ * @note  a failed write keeps its keys pending until the next change
+ */
+static void config_write(void* context)
+{
+    if(!config_quiet())
+    {
+        config_deferred++;
+        sched_start(&config_task, CONFIG_RETRY_MS, NULL);
+        return;
+    }
+
+    HAL_FLASH_Unlock();
+    for(uint8_t key = 0; (key < CONFIG_KEYS) && (config_dirty != 0); key++)
+    {
+        if((config_dirty & (1U << key)) && !config_append((config_key_t)key))
+        {
+            break;
+        }
+    }
+    HAL_FLASH_Lock();
+
+    UART_Printf(UART_DEBUG, "Config written, page %u at %u, pending %02x\r\n", config_page, config_offset,
+                config_dirty);
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Load the values from flash, called once before USB is started
+ * @note  erases here stall the CPU for tens of ms, USB must not enumerate meanwhile;
+ *        nothing is printed, the debug UART is not initialized yet
+ */
+void config_init(void)
+{
+    uint16_t state[CONFIG_PAGES] = { config_read(0, 0), config_read(1, 0) };
+    int8_t valid = -1;
+    int8_t receive = -1;
+    uint16_t end;
+
+    for(uint8_t key = 0; key < CONFIG_KEYS; key++)
+    {
+        config_assign((config_key_t)key, config_keys[key].value, (uint8_t)strlen(config_keys[key].value));
+    }
+
+    HAL_FLASH_Unlock();
+    for(uint8_t page = 0; page < CONFIG_PAGES; page++)
+    {
+        if(state[page] == CONFIG_PAGE_VALID)
+        {
+            // two valid pages are not written by this code, the newer one wins
+            if((valid < 0) || ((int16_t)(config_read(page, 2) - config_read((uint8_t)valid, 2)) > 0))
+            {
+                valid = (int8_t)page;
+            }
+        }
+        else if(state[page] == CONFIG_PAGE_RECEIVE)
+        {
+            receive = (int8_t)page;
+        }
+    }
+
+    if(receive >= 0)
+    {
+        if(config_scan((uint8_t)receive, 0, &end) == CONFIG_ALL_KEYS)
+        {
+            // transfer cut after the records: finish it
+            if(valid >= 0)
+            {
+                config_erase((uint8_t)valid);
+            }
+            config_program((uint8_t)receive, 0, CONFIG_PAGE_VALID);
+            valid = receive;
+        }
+        else
+        {
+            config_erase((uint8_t)receive);
+        }
+    }
+
+    if(valid < 0)
+    {
+        // blank device or unknown content
+        if(!config_erased(0, 0, FLASH_PAGE_SIZE))
+        {
+            config_erase(0);
+        }
+        config_program(0, 0, CONFIG_PAGE_VALID);
+        config_program(0, 2, 0);
+        valid = 0;
+    }
+
+    config_page = (uint8_t)valid;
+    if(!config_erased(config_page ^ 1U, 0, FLASH_PAGE_SIZE))
+    {
+        config_erase(config_page ^ 1U);
+    }
+    HAL_FLASH_Lock();
+
+    config_generation = config_read(config_page, 2);
+    config_scan(config_page, 1, &config_offset);
+    config_dirty = 0;
+}
+
+/**
+ * @brief Reply of the get command of a key, value and '#'
+ */
+const char* config_reply(config_key_t key)
+{
+    return config_mirror[key].text;
+}
+
+/**
+ * @brief Change a value, written to flash by the task later
+ * @param value: not terminated, the degree sign 0xDF is stored as '*'
+ * @retval 1 if valid (also unchanged), 0 if rejected
+ */
+uint8_t config_set(config_key_t key, const char* value, uint8_t length)
+{
+    char text[CONFIG_VALUE_MAX_LEN];
+
+    if((key >= CONFIG_KEYS) || (length == 0) || (length > CONFIG_VALUE_MAX_LEN))
+    {
+        return 0;
+    }
+    for(uint8_t n = 0; n < length; n++)
+    {
+        text[n] = ((uint8_t)value[n] == 0xDFU) ? '*' : value[n];
+        // the reply ends at '#', ',' separates the :XC# fields
+        if((text[n] < ' ') || (text[n] > '~') || (text[n] == '#') || (text[n] == ','))
+        {
+            return 0;
+        }
+    }
+    if(!config_valid(key, text, length))
+    {
+        return 0;
+    }
+
+    if((config_mirror[key].length == length) && (memcmp(config_mirror[key].text, text, length) == 0))
+    {
+        // no flash wear for clients sending the site on every connect
+        return 1;
+    }
+    config_assign(key, text, length);
+    config_dirty |= (uint8_t)(1U << key);
+    // restarted by every change, a batch is written at once
+    sched_start(&config_task, CONFIG_WRITE_DELAY_MS, NULL);
+    return 1;
+}
+
+/**
+ * @brief Back to the values of config_keys[]
+ */
+void config_defaults(void)
+{
+    for(uint8_t key = 0; key < CONFIG_KEYS; key++)
+    {
+        config_set((config_key_t)key, config_keys[key].value, (uint8_t)strlen(config_keys[key].value));
+    }
+}
+
+/**
+ * @brief Keys changed but not written yet, bit per key
+ */
+uint8_t config_pending(void)
+{
+    return config_dirty;
+}
+
+/**
+ * @brief :XC# reply, see the file header for the format
+ */
+void config_format(char* buffer, uint16_t size)
+{
+    snprintf(buffer, size, "%.*s,%.*s,%.*s,%u,%u,%lu,%lu,%lu,%02x,%.*s#",
+             config_mirror[CONFIG_LATITUDE].length, config_mirror[CONFIG_LATITUDE].text,
+             config_mirror[CONFIG_LONGITUDE].length, config_mirror[CONFIG_LONGITUDE].text,
+             config_mirror[CONFIG_TRACKING_RATE].length, config_mirror[CONFIG_TRACKING_RATE].text,
+             config_generation, config_offset, (unsigned long)config_writes, (unsigned long)config_deferred,
+             (unsigned long)config_errors, config_dirty,
+             config_mirror[CONFIG_SITE_NAME].length, config_mirror[CONFIG_SITE_NAME].text);
+}
@@ -0,0 +1,60 @@
+/*
+ ******************************************************************************
+ * @file    config_store.h
+ * @brief   Header for the persistent configuration in emulated EEPROM
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* last two 1K pages of the 64K part, kept out of FLASH in STM32F103C8TX_FLASH.ld */
+#ifndef CONFIG_FLASH_ADDRESS
+#define CONFIG_FLASH_ADDRESS    0x0800F800U
+#endif
+
+/* longest value, the site name */
+#define CONFIG_VALUE_MAX_LEN    16
+
+/* changes within this time are written together */
+#define CONFIG_WRITE_DELAY_MS   2000
+/* flash is only written after this time without USB data */
+#define CONFIG_QUIET_MS         500
+/* next try while USB, ST4 or the mount link are busy */
+#define CONFIG_RETRY_MS         100
+/* page transfer: two erases and the records */
+#define CONFIG_WRITE_BUDGET_US  50000
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef enum {
+    CONFIG_SITE_NAME = 0,
+    CONFIG_LATITUDE,
+    CONFIG_LONGITUDE,
+    CONFIG_TRACKING_RATE,
+    CONFIG_KEYS
+} config_key_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void config_init(void);
+const char* config_reply(config_key_t key);
+uint8_t config_set(config_key_t key, const char* value, uint8_t length);
+void config_defaults(void);
+uint8_t config_pending(void);
+void config_format(char* buffer, uint16_t size);
+
+#endif // CONFIG_STORE_H
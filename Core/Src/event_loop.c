@@ -0,0 +1,178 @@
+/*
+ ******************************************************************************
+ * @file    event_loop.c
+ * @brief   Event flags of the interrupts and the idle wait of the main loop
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Interrupts post their work as event flags, the main loop sleeps in WFI
+ * until a flag is set or the nearest deadline of the modules is reached.
+ * WFI is entered with PRIMASK set: a pending interrupt still wakes the core,
+ * it runs when PRIMASK is cleared again, so a flag posted between the check
+ * and the WFI is never missed.
+ *
+ * SysTick stays the HAL time base and wakes the core every ms, such a wake
+ * without flag and before the deadline goes back to sleep without a pass.
+ *
+ * The idle share is the window time minus the cycles spent in passes, the
+ * DWT counter is only read while the core runs. Interrupts served during
+ * the sleep count as idle.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include "main.h"
+#include "perf_counter.h"
+#include "event_loop.h"
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static volatile uint32_t event_flags = 0;
+/* cycle counter at the first post since the last pass */
+static volatile uint32_t event_posted_cycles = 0;
+
+static event_stats_t event_stats;
+
+static uint32_t pass_start_cycles = 0;
+static uint8_t pass_running = 0;
+static uint32_t window_tick = 0;
+static uint64_t window_busy_cycles = 0;
+/* start of the last pass with USB data */
+static uint32_t usb_rx_tick = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Close the idle window when it is complete
+ */
+static void event_account_window(void)
+{
+    uint32_t elapsed_ms = HAL_GetTick() - window_tick;
+
+    if(elapsed_ms < EVENT_IDLE_WINDOW_MS)
+    {
+        return;
+    }
+
+    uint64_t window_cycles = (uint64_t)elapsed_ms * (SystemCoreClock / 1000U);
+
+    if(window_busy_cycles >= window_cycles)
+    {
+        event_stats.idle_permille = 0;
+    }
+    else
+    {
+        event_stats.idle_permille = (uint16_t)(1000U - window_busy_cycles * 1000U / window_cycles);
+    }
+    window_busy_cycles = 0;
+    window_tick += elapsed_ms;
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Post work for the main loop (interrupt context)
+ * @param events: EVENT_ flags
+ */
+void event_post(uint32_t events)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if(event_flags == 0)
+    {
+        event_posted_cycles = perf_cycles();
+    }
+    event_flags |= events;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Flags posted since the last pass
+ */
+uint32_t event_pending(void)
+{
+    return event_flags;
+}
+
+/**
+ * @brief Count the cycles of the current pass, called by event_wait() or after a
+ *        pass that waits elsewhere (host build)
+ */
+void event_pass_end(void)
+{
+    if(pass_running)
+    {
+        window_busy_cycles += perf_cycles() - pass_start_cycles;
+        pass_running = 0;
+    }
+}
+
+/**
+ * @brief End the current pass and sleep until an event is posted or the timeout expired
+ * @param timeout_ms: HAL ticks to wait at most, 0 only takes the posted events
+ * @retval events of the new pass
+ */
+uint32_t event_wait(uint32_t timeout_ms)
+{
+    uint32_t start_tick = HAL_GetTick();
+    uint32_t events;
+    uint32_t posted;
+
+    event_pass_end();
+
+    __disable_irq();
+    while((event_flags == 0) && ((HAL_GetTick() - start_tick) < timeout_ms))
+    {
+        __WFI();
+        // the interrupt that woke the core runs here
+        __enable_irq();
+        __disable_irq();
+        event_stats.wakeups++;
+    }
+    events = event_flags;
+    posted = event_posted_cycles;
+    event_flags = 0;
+    __enable_irq();
+
+    pass_start_cycles = perf_cycles();
+    pass_running = 1;
+    event_stats.passes++;
+    if(events & EVENT_USB_RX)
+    {
+        usb_rx_tick = HAL_GetTick();
+    }
+    if(events != 0)
+    {
+        uint32_t latency = pass_start_cycles - posted;
+
+        event_stats.event_passes++;
+        event_stats.latency_sum_cycles += latency;
+        if(latency > event_stats.latency_max_cycles)
+        {
+            event_stats.latency_max_cycles = latency;
+        }
+    }
+    event_account_window();
+    return events;
+}
+
+/**
+ * @brief Time since the last pass with USB data (client quiet)
+ */
+uint32_t event_usb_idle_ms(void)
+{
+    return HAL_GetTick() - usb_rx_tick;
+}
+
+const event_stats_t* event_get_stats(void)
+{
+    return &event_stats;
+}
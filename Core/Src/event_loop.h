@@ -0,0 +1,69 @@
+/*
+ ******************************************************************************
+ * @file    event_loop.h
+ * @brief   Header for the event flags and the idle wait of the main loop
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* work posted by the interrupts */
+#define EVENT_USB_RX            (1U << 0)   // USB packet queued for the parser
+#define EVENT_MOUNT_RX          (1U << 1)   // mount bytes received (IDLE / DMA) or UART error
+#define EVENT_MOUNT_TX          (1U << 2)   // mount transfer complete
+
+/* no deadline pending */
+#define EVENT_NO_DEADLINE       UINT32_MAX
+/* longest sleep without a pass, limits the damage of a missed deadline */
+#define EVENT_MAX_SLEEP_MS      100
+/* interval of the idle share measurement */
+#define EVENT_IDLE_WINDOW_MS    1000
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef struct {
+    uint32_t passes;            // main loop passes
+    uint32_t event_passes;      // passes started by an interrupt event
+    uint32_t wakeups;           // returns from WFI, passes or not (SysTick every ms)
+    uint32_t latency_max_cycles;    // first event posted until its pass started
+    uint64_t latency_sum_cycles;
+    uint16_t idle_permille;     // time without a pass in the last window in 0.1%
+} event_stats_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief HAL ticks until a deadline, 0 if it is reached (for the *_next_ms() functions)
+ */
+static inline uint32_t event_ms_until(uint32_t due_tick, uint32_t now)
+{
+    /* int32_t cast handles HAL_GetTick() overflow correctly */
+    return ((int32_t)(due_tick - now) > 0) ? (due_tick - now) : 0;
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void event_post(uint32_t events);
+uint32_t event_pending(void);
+uint32_t event_wait(uint32_t timeout_ms);
+void event_pass_end(void);
+uint32_t event_usb_idle_ms(void);
+const event_stats_t* event_get_stats(void);
+
+#endif // EVENT_LOOP_H
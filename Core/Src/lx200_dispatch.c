@@ -0,0 +1,317 @@
+/*
+ ******************************************************************************
+ * @file    lx200_dispatch.c
+ * @brief   Table driven LX200 command dispatcher
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <string.h>
+#include "main.h"
+#include "usbd_cdc_if.h"
+#include "st4_handler.h"
+#include "lx200_dispatch.h"
+#include "lx200_latency.h"
+#include "scheduler.h"
+
+/* ============================================================================
+ *                         PRIVATE FUNCTION PROTOTYPES
+ * ============================================================================ */
+static void lx200_repeat(void* context);
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+/* command sent once more after the repeat_ms of its rule, one at a time */
+static char repeat_command[LX200_REWRITE_MAX_LEN];
+static const lx200_command_t* repeat_entry = NULL;
+static lx200_forward_t repeat_send = NULL;
+/* the command in dispatch is not repeated, set by lx200_repeat_cancel() */
+static uint8_t repeat_cancelled = 0;
+
+static const sched_task_t repeat_task = { "repeat", lx200_repeat, 0, 200 };
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Hash of the two characters following ':' (e.g. "GR", "Mg", "Q#")
+ */
+static inline uint8_t lx200_hash(char c1, char c2)
+{
+    return ((uint8_t)c1 * 31u + (uint8_t)c2) & (LX200_DISPATCH_SLOTS - 1);
+}
+
+/**
+ * @brief Build the hash index of a table
+ * @note  rows with the same 2 character key share one slot and are chained
+ */
+static void lx200_build_index(lx200_dispatch_table_t* table)
+{
+    memset(table->slot, 0, sizeof(table->slot));
+    memset(table->next, 0, sizeof(table->next));
+
+    for(uint8_t row = 0; (row < table->count) && (row < LX200_DISPATCH_MAX_COMMANDS); row++)
+    {
+        const char* prefix = table->commands[row].prefix;
+        uint8_t h = lx200_hash(prefix[1], prefix[2]);
+
+        while(table->slot[h] != 0)
+        {
+            uint8_t first = table->slot[h] - 1;
+            const char* other = table->commands[first].prefix;
+
+            if((other[1] == prefix[1]) && (other[2] == prefix[2]))
+            {
+                // same key, append to the end of the chain
+                while(table->next[first] != 0)
+                {
+                    first = table->next[first] - 1;
+                }
+                table->next[first] = row + 1;
+                break;
+            }
+            h = (h + 1) & (LX200_DISPATCH_SLOTS - 1);
+        }
+
+        if(table->slot[h] == 0)
+        {
+            table->slot[h] = row + 1;
+        }
+    }
+
+    table->ready = 1;
+}
+
+/**
+ * @brief Send a fixed reply of a table row
+ */
+static void lx200_table_respond(const lx200_dispatch_table_t* table, const char* response)
+{
+    if(table->respond != NULL)
+    {
+        table->respond(response);
+    }
+    else
+    {
+        lx200_respond(response);
+    }
+}
+
+/**
+ * @brief Default of the action of a row without handler
+ */
+static void lx200_dispatch_action(lx200_dispatch_table_t* table, const char* command, const lx200_command_t* entry)
+{
+    switch(entry->action)
+    {
+        case LX200_LOCAL:
+            if(entry->response != NULL)
+            {
+                lx200_table_respond(table, entry->response);
+                UART_Printf(UART_DEBUG, "-> %s: %s\r\n", entry->description, entry->response);
+            }
+            else
+            {
+                UART_Printf(UART_DEBUG, "-> %s\r\n", entry->description);
+            }
+            break;
+        case LX200_ST4:
+            st4_set((ST4_Direction_t)entry->arg, st4_parse_duration(command));
+            break;
+        case LX200_REWRITE:
+        case LX200_FORWARD:
+            if(table->forward != NULL)
+            {
+                if(!table->forward(command, entry))
+                {
+                    lx200_repeat_cancel();
+                }
+                UART_Printf(UART_DEBUG, "-> %s, send to mount\r\n", entry->description);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Second send of a command with repeat_ms, called by the scheduler
+ * @note  the client got the reply of the first send
+ */
+static void lx200_repeat(void* context)
+{
+    repeat_send(repeat_command, repeat_entry);
+}
+
+/**
+ * @brief Send a command once more after a delay, a pending repetition is dropped
+ *        (e.g. :Q# is not followed by an old :MS#)
+ */
+static void lx200_repeat_after(lx200_dispatch_table_t* table, const char* command,
+                               const lx200_command_t* entry, uint16_t delay_ms)
+{
+    size_t len = strlen(command);
+
+    sched_stop(&repeat_task);
+    if((table->resend == NULL) || (len >= sizeof(repeat_command)))
+    {
+        return;
+    }
+    memcpy(repeat_command, command, len + 1);
+    repeat_entry = entry;
+    repeat_send = table->resend;
+    sched_start(&repeat_task, delay_ms, NULL);
+    UART_Printf(UART_DEBUG, "-> %s again in %u ms\r\n", entry->description, delay_ms);
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Find the table row of a command
+ * @param table: dispatch table
+ * @param command: complete command string starting with ':'
+ * @retval longest matching row, NULL if the command is not in the table
+ */
+const lx200_command_t* lx200_lookup(lx200_dispatch_table_t* table, const char* command)
+{
+    if(!table->ready)
+    {
+        lx200_build_index(table);
+    }
+
+    if((command[0] != ':') || (command[1] == '\0'))
+    {
+        return NULL;
+    }
+
+    uint8_t h = lx200_hash(command[1], command[2]);
+
+    while(table->slot[h] != 0)
+    {
+        uint8_t row = table->slot[h] - 1;
+        const char* prefix = table->commands[row].prefix;
+
+        if((prefix[1] == command[1]) && (prefix[2] == command[2]))
+        {
+            // walk the (short) chain of this key, the longest prefix wins
+            const lx200_command_t* best = NULL;
+            size_t best_len = 0;
+
+            for(;;)
+            {
+                const lx200_command_t* entry = &table->commands[row];
+                size_t len = strlen(entry->prefix);
+
+                if((len > best_len) && (strncmp(command, entry->prefix, len) == 0))
+                {
+                    best = entry;
+                    best_len = len;
+                }
+                if(table->next[row] == 0)
+                {
+                    break;
+                }
+                row = table->next[row] - 1;
+            }
+            return best;
+        }
+        h = (h + 1) & (LX200_DISPATCH_SLOTS - 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Execute a command according to its table row
+ * @param table: dispatch table
+ * @param command: complete command string starting with ':'
+ * @note  REWRITE rows: the handler / forward get the command rewritten by the rule
+ */
+void lx200_dispatch(lx200_dispatch_table_t* table, const char* command)
+{
+    const lx200_command_t* entry = lx200_lookup(table, command);
+    const lx200_rule_t* rule = NULL;
+    char rewritten[LX200_REWRITE_MAX_LEN];
+
+    lx200_latency_class((entry != NULL) ? (uint8_t)entry->action : LX200_LATENCY_UNKNOWN);
+
+    if(entry == NULL)
+    {
+        if((table->default_action == LX200_FORWARD) && (table->forward != NULL))
+        {
+            /* not handled command, send direct to mount */
+            table->forward(command, NULL);
+            UART_Printf(UART_DEBUG, "-> send to mount\r\n");
+        }
+        else
+        {
+            UART_Printf(UART_DEBUG, "!! Unknown command\r\n");
+        }
+        return;
+    }
+
+    if((entry->action == LX200_REWRITE) && (entry->rule != NULL))
+    {
+        rule = entry->rule;
+        if(rule->op == LX200_RULE_RESPOND)
+        {
+            lx200_table_respond(table, rule->text);
+            UART_Printf(UART_DEBUG, "-> %s: %s\r\n", entry->description, rule->text);
+            return;
+        }
+        command = lx200_rewrite_apply(rule, command, rewritten, sizeof(rewritten));
+        if(command == NULL)
+        {
+            UART_Printf(UART_DEBUG, "!! %s too long to rewrite\r\n", entry->description);
+            return;
+        }
+        DEBUG_PRINTF(UART_DEBUG, "-> rewritten: %s\r\n", command);
+    }
+
+    repeat_cancelled = 0;
+    if(entry->handler != NULL)
+    {
+        entry->handler(command, entry);
+    }
+    else
+    {
+        lx200_dispatch_action(table, command, entry);
+    }
+
+    if((rule != NULL) && (rule->repeat_ms > 0) && !repeat_cancelled)
+    {
+        lx200_repeat_after(table, command, entry, rule->repeat_ms);
+    }
+}
+
+/**
+ * @brief Drop the pending repetition and that of the command in dispatch,
+ *        e.g. its first send was rejected or a manual move took over
+ */
+void lx200_repeat_cancel(void)
+{
+    repeat_cancelled = 1;
+    sched_stop(&repeat_task);
+}
+
+/**
+ * @brief Send a reply to the client via USB CDC
+ */
+void lx200_respond(const char* response)
+{
+    size_t len = strlen(response);
+
+    if(len > 0)
+    {
+        CDC_Transmit_FS((uint8_t*)response, len);
+        lx200_latency_responded();
+    }
+}
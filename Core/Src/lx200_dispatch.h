@@ -0,0 +1,87 @@
+/*
+ ******************************************************************************
+ * @file    lx200_dispatch.h
+ * @brief   Header for table driven LX200 command dispatcher
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef LX200_DISPATCH_H
+#define LX200_DISPATCH_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+#include "lx200_rewrite.h"
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* hash slots per table, must be a power of two and larger than the table */
+#define LX200_DISPATCH_SLOTS        64
+#define LX200_DISPATCH_MAX_COMMANDS 48
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef enum {
+    LX200_LOCAL = 0,    // answered by the proxy itself
+    LX200_REWRITE,      // modified by the rule of the row and sent to the mount
+    LX200_FORWARD,      // sent unchanged to the mount
+    LX200_ST4           // mapped to a ST4 guide pulse, arg is the direction
+} lx200_action_t;
+
+typedef struct lx200_command lx200_command_t;
+
+typedef void (*lx200_handler_t)(const char* command, const lx200_command_t* entry);
+typedef uint8_t (*lx200_forward_t)(const char* command, const lx200_command_t* entry);
+typedef void (*lx200_respond_t)(const char* response);
+
+/* one const table row per command */
+struct lx200_command {
+    const char* prefix;         // command start incl. ':', e.g. ":GR#" or ":Sr"
+    lx200_action_t action;
+    lx200_handler_t handler;    // optional, replaces the default of the action
+    const char* response;       // LOCAL: fixed reply, NULL for no reply
+    uint8_t arg;                // ST4: direction
+    const char* description;    // debug output
+    uint8_t reply;              // commands for the mount: form of the reply (mount_reply_kind_t)
+    const lx200_rule_t* rule;   // REWRITE: applied before the handler / forward
+};
+
+/* dispatch table, the hash index is built on first use */
+typedef struct {
+    const lx200_command_t* commands;
+    uint8_t count;
+    lx200_action_t default_action;  // for commands not in the table (LOCAL = unknown)
+    lx200_forward_t forward;        // sends a command to the mount, entry is NULL if not in the table
+    lx200_forward_t resend;         // sends a repeated command (rule repeat_ms), the reply is consumed
+    lx200_respond_t respond;        // sends a fixed reply (LOCAL response, RESPOND rule), NULL for lx200_respond()
+    uint8_t ready;
+    uint8_t slot[LX200_DISPATCH_SLOTS];         // hash slot -> first row + 1
+    uint8_t next[LX200_DISPATCH_MAX_COMMANDS];  // next row + 1 with the same 2 character key
+} lx200_dispatch_table_t;
+
+/* rows past LX200_DISPATCH_MAX_COMMANDS would never be found, the row count is checked
+ * at compile time (a _Static_assert is a declaration, hence the struct inside sizeof) */
+#define LX200_DISPATCH_ROWS(rows) \
+    ((uint8_t)(sizeof(rows) / sizeof((rows)[0]) + 0 * sizeof(struct { \
+        _Static_assert(sizeof(rows) / sizeof((rows)[0]) <= LX200_DISPATCH_MAX_COMMANDS, \
+                       "too many rows, raise LX200_DISPATCH_MAX_COMMANDS"); \
+        int unused; })))
+
+#define LX200_DISPATCH_TABLE(rows, default_action, forward, resend, respond) \
+    { (rows), LX200_DISPATCH_ROWS(rows), (default_action), (forward), (resend), (respond), 0, {0}, {0} }
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+const lx200_command_t* lx200_lookup(lx200_dispatch_table_t* table, const char* command);
+void lx200_dispatch(lx200_dispatch_table_t* table, const char* command);
+void lx200_respond(const char* response);
+void lx200_repeat_cancel(void);
+
+#endif // LX200_DISPATCH_H
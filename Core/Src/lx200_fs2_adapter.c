@@ -16,162 +16,446 @@
 #include "main.h"
 #include "usbd_cdc_if.h"
 #include "st4_handler.h"
+#include "mount_reply.h"
+#include "mount_cache.h"
+#include "mount_poller.h"
+#include "mount_shadow.h"
+#include "lx200_latency.h"
+#include "mount_rtt.h"
+#include "proxy_stats.h"
+#include "scheduler.h"
+#include "lx200_dispatch.h"
+#include "perf_counter.h"
+#include "event_loop.h"
+#include "config_store.h"
 
 /* ============================================================================
  *                         PRIVATE DEFINES
  * ============================================================================ */
+/* delay between the two sends of :MS# and :Q# (FS2 bug workaround) */
+#ifndef FS2_RESEND_DELAY_MS
+#define FS2_RESEND_DELAY_MS 50
+#endif
+
+/* arg of the position commands */
+#define FS2_AXIS_RA         MOUNT_SHADOW_RA
+#define FS2_AXIS_DEC        MOUNT_SHADOW_DEC
 
 /* ============================================================================
  *                         PRIVATE VARIABLES
  * ============================================================================ */
-static char corrected_command[64];
+/* :XH# :XR# :XT# answer, too large for the stack */
+static char dump[MOUNT_REPLY_LOCAL_MAX_LEN];
 
 /* ============================================================================
  *                         PRIVATE FUNCTIONS
  * ============================================================================ */
 
-/* ============================================================================
- *                         PUBLIC FUNCTIONS
- * ============================================================================ */
+/**
+ * @brief Send a client command to the FS2, the reply is passed back to USB
+ * @param entry: table row, NULL for commands not in the table
+ */
+static uint8_t fs2_forward(const char* command, const lx200_command_t* entry)
+{
+    mount_reply_kind_t kind = (entry != NULL) ? (mount_reply_kind_t)entry->reply : MOUNT_REPLY_UNKNOWN;
 
-/* ----------------------------------------------------------------------------
- *                         FS2 COMMAND PROCESSOR
- * ---------------------------------------------------------------------------- */
-void ProcessLX200Command_FS2(char* command)
+    return mount_request(command, kind, MOUNT_OWNER_CLIENT, NULL, 0);
+}
+
+/**
+ * @brief Second send of a rule with repeat_ms (FS2 workaround), called by the scheduler
+ * @note  the client got the reply of the first send, the second one is consumed
+ */
+static uint8_t fs2_resend(const char* command, const lx200_command_t* entry)
 {
-    // Debug output of recognized command
-    UART_Printf(UART_DEBUG, "%s\r\n", command);
-    
-    char response[64] = "";
-    
-    // LX200 Kommando-Parsing for non FS commands
-    if(strncmp(command, ":GM#", 4) == 0)
-    {
-        // Get Site 1 Name
-        strcpy(response, "LX200 Site#");
-        UART_Printf(UART_DEBUG, "-> Get Site Name: %s\r\n", response);
-    }
-    else if(strncmp(command, ":Gt#", 4) == 0)
+    return mount_request(command, (mount_reply_kind_t)entry->reply, MOUNT_OWNER_PROXY, NULL, 0);
+}
+
+/**
+ * @brief Send a target coordinate, unless the mount acknowledged it already
+ */
+static void fs2_send_target(const char* command, const lx200_command_t* entry)
+{
+    if(mount_shadow_target_unchanged(entry->arg, command))
     {
-        // Get Current Site Latitude
-        strcpy(response, "+47*59:46#");
-        UART_Printf(UART_DEBUG, "-> Get Site Latitude: %s\r\n", response);
+        // same reply as the mount would give, behind pending client replies
+        mount_reply_local("1");
+        mount_shadow_saved(strlen(command) + 1);
+        UART_Printf(UART_DEBUG, "-> %s unchanged, answered locally\r\n", entry->description);
+        return;
     }
-    else if(strncmp(command, ":Gg#", 4) == 0)
+
+    mount_request(command, MOUNT_REPLY_CHAR, MOUNT_OWNER_CLIENT,
+                  mount_shadow_target_reply, mount_shadow_target_sent(entry->arg, command));
+}
+
+/**
+ * @brief :RS# :RM# :RC# :RG#, only sent if the rate changes
+ */
+static void fs2_set_rate(const char* command, const lx200_command_t* entry)
+{
+    if(mount_shadow_rate_unchanged(command))
     {
-        // Get Current Site Longitude  
-        strcpy(response, "+007*51:10#");
-        UART_Printf(UART_DEBUG, "-> Get Site Longitude: %s\r\n", response);
+        mount_shadow_saved(strlen(command));
+        UART_Printf(UART_DEBUG, "-> %s unchanged, not sent\r\n", entry->description);
+        return;
     }
-    else if(strncmp(command, ":GT#", 4) == 0)
+
+    mount_shadow_rate_sent(command);
+    fs2_forward(command, entry);
+    UART_Printf(UART_DEBUG, "-> %s, send to mount\r\n", entry->description);
+}
+
+/**
+ * @brief :GR# and :GD#, answered from the position cache while it is fresh,
+ *        otherwise the mount reply refreshes the cache
+ * @note  a cache hit waits behind pending client replies (e.g. ":GD#:GR#"
+ *        in one USB packet), see mount_reply_local()
+ */
+static void fs2_get_position(const char* command, const lx200_command_t* entry)
+{
+    char answer[16];
+    uint8_t fresh = (entry->arg == FS2_AXIS_RA) ? mount_cache_get_ra(answer, sizeof(answer))
+                                               : mount_cache_get_dec(answer, sizeof(answer));
+
+    if(fresh)
     {
-        // Get Tracking Rate
-        strcpy(response, "60.1#");
-        UART_Printf(UART_DEBUG, "-> Get Tracking Rate: %s\r\n", response);
+        mount_reply_local(answer);
+        DEBUG_PRINTF(UART_DEBUG, "-> %s from cache: %s\r\n", entry->description, answer);
+        return;
     }
-    else if(strncmp(command, ":Sr", 3) == 0)
+
+    mount_request(command, MOUNT_REPLY_HASH, MOUNT_OWNER_CLIENT,
+                  (entry->arg == FS2_AXIS_RA) ? mount_cache_update_ra : mount_cache_update_dec,
+                  mount_cache_generation());
+    UART_Printf(UART_DEBUG, "-> %s, send to mount\r\n", entry->description);
+}
+
+/**
+ * @brief Commands moving the mount or changing the reply format,
+ *        the cached position is no longer valid
+ */
+static void fs2_forward_invalidate(const char* command, const lx200_command_t* entry)
+{
+    // a newer motion command: an old :MS# / :Q# must not be sent again
+    if((entry->rule == NULL) || (entry->rule->repeat_ms == 0))
     {
-        // Set Right Ascension, check for FS2 must have space character
-        if(command[3] == ' ')
-        {
-            // all ok, send direct to FS2
-            UART_Printf(UART_DEBUG, "-> space ok, send to FS2\r\n");
-            UART_Printf(UART_OUT, command);
-        }
-        else
-        {
-            // No space after ":Sr" - insert one at position 3
-            strncpy(&corrected_command[0], &command[0],3);
-            corrected_command[3] = ' ';
-            strcpy(&corrected_command[4], &command[3]);
-            
-            UART_Printf(UART_DEBUG, "-> space inserted, corrected: %s\r\n", corrected_command);
-            UART_Printf(UART_OUT, corrected_command);
-        }
-        strcpy(response, "");
+        lx200_repeat_cancel();
     }
-    else if(strncmp(command, ":Sd", 3) == 0)
+    mount_cache_invalidate();
+    mount_poller_moved();
+    if(!fs2_forward(command, entry))
     {
-        // Set Declination, check for FS2 must have space character
-        if(command[3] == ' ')
-        {
-            // all ok, send direct to FS2
-            UART_Printf(UART_DEBUG, "-> space ok, send to FS2\r\n");
-            UART_Printf(UART_OUT, command);
-        }
-        else
-        {
-            // No space after ":Sd" - insert one at position 3
-            strncpy(&corrected_command[0], &command[0],3);
-            corrected_command[3] = ' ';
-            strcpy(&corrected_command[4], &command[3]);
-            
-            UART_Printf(UART_DEBUG, "-> space inserted, corrected: %s\r\n", corrected_command);
-            UART_Printf(UART_OUT, corrected_command);
-        }
-        strcpy(response, "");
+        // rejected (transmit queue full), no second send
+        lx200_repeat_cancel();
     }
-    else if(strncmp(command, ":MS#", 4) == 0)
+    UART_Printf(UART_DEBUG, "-> %s, send to mount\r\n", entry->description);
+}
+
+/**
+ * @brief :XP# poller status "budget%,utilization 0.1%,polls,timeouts,slewing#",
+ *        :XPnn# sets the link budget of the poller to nn percent
+ */
+static void fs2_poller_status(const char* command, const lx200_command_t* entry)
+{
+    char answer[48];
+    const mount_poller_stats_t* stats;
+
+    if((command[3] >= '0') && (command[3] <= '9'))
     {
-        // there is a bug in the FS2 that the MS (move to target) command is aborted -> send two times
-        UART_Printf(UART_OUT, ":MS#");
-        UART_Printf(UART_DEBUG, "-> FS2 BUGFIX, send :MS# two times\r\n");
-        volatile uint32_t count = 50 * 18000;
-        while(count--);
-        UART_Printf(UART_OUT, ":MS#");
-        strcpy(response, "");
+        mount_poller_set_budget((uint8_t)atoi(&command[3]));
     }
-    else if(strncmp(command, ":Q#", 3) == 0)
+
+    stats = mount_poller_get_stats();
+    snprintf(answer, sizeof(answer), "%u,%u,%lu,%lu,%u#", stats->budget_pct, stats->utilization,
+             (unsigned long)stats->polls, (unsigned long)stats->timeouts, stats->slewing);
+    mount_reply_local(answer);
+    UART_Printf(UART_DEBUG, "-> %s: %s\r\n", entry->description, answer);
+}
+
+/**
+ * @brief :XH# dump the latency histograms, :XH<class># those of one class, :XHR# reset them
+ */
+static void fs2_latency(const char* command, const lx200_command_t* entry)
+{
+    if(command[3] == 'R')
     {
-        // there is a bug in the FS2 that the Q (stop movingt) not executed -> send two times
-        UART_Printf(UART_OUT, ":Q#");
-        UART_Printf(UART_DEBUG, "-> FS2 BUGFIX, send :Q# two times\r\n");
-        volatile uint32_t count = 50 * 18000;
-        while(count--);
-        UART_Printf(UART_OUT, ":Q#");
-        strcpy(response, "");
+        lx200_latency_reset();
+        mount_reply_local("1");
+        UART_Printf(UART_DEBUG, "-> %s reset\r\n", entry->description);
+        return;
     }
-    /* Guiding commands, will be mapped to ST4 output*/
-    else if(strncmp(command, ":Mgn", 4) == 0)
+
+    lx200_latency_format(dump, sizeof(dump), (command[3] != '#') ? command[3] : '\0');
+    mount_reply_local(dump);
+    UART_Printf(UART_DEBUG, "-> %s\r\n", entry->description);
+}
+
+/**
+ * @brief :XR# mount round trip times, :XRR# reset them
+ */
+static void fs2_round_trip(const char* command, const lx200_command_t* entry)
+{
+    if(command[3] == 'R')
     {
-        // Move guide rate North with duration parameter
-        uint32_t duration = st4_parse_duration(command);
-        st4_set(ST4_NORTH, duration);
-        strcpy(response, "");
+        mount_rtt_reset();
+        mount_reply_local("1");
+        UART_Printf(UART_DEBUG, "-> %s reset\r\n", entry->description);
+        return;
     }
-    else if(strncmp(command, ":Mgs", 4) == 0)
+
+    mount_rtt_format(dump, sizeof(dump));
+    mount_reply_local(dump);
+    UART_Printf(UART_DEBUG, "-> %s\r\n", entry->description);
+}
+
+/**
+ * @brief :XS# runtime counters, polled by clients during the night
+ */
+static void fs2_statistics(const char* command, const lx200_command_t* entry)
+{
+    char answer[PROXY_STATS_FRAME_SIZE];
+
+    proxy_stats_format(answer, sizeof(answer));
+    mount_reply_local(answer);
+    DEBUG_PRINTF(UART_DEBUG, "-> %s: %s\r\n", entry->description, answer);
+}
+
+/**
+ * @brief :XA# measured ST4 pulse length error "pulses,mean,min,max#" in us
+ */
+static void fs2_st4_accuracy(const char* command, const lx200_command_t* entry)
+{
+    char answer[48];
+    const ST4_Accuracy_t* accuracy = st4_get_accuracy();
+    int32_t mean_us = (accuracy->pulses > 0) ? (int32_t)(accuracy->sum_error_us / accuracy->pulses) : 0;
+
+    snprintf(answer, sizeof(answer), "%lu,%ld,%ld,%ld#", (unsigned long)accuracy->pulses, (long)mean_us,
+             (long)accuracy->min_error_us, (long)accuracy->max_error_us);
+    mount_reply_local(answer);
+    DEBUG_PRINTF(UART_DEBUG, "-> %s: %s\r\n", entry->description, answer);
+}
+
+/**
+ * @brief :XG# guide pulse handling
+ *        "policy,opposing,dec queue,ra queue,replaced,extended,queued,dropped,netted,cancelled#",
+ *        :XGx# / :XGxy# set the policy R / E / Q and the opposing mode C / N first
+ */
+static void fs2_guide_status(const char* command, const lx200_command_t* entry)
+{
+    static const char policy_names[] = { 'R', 'E', 'Q' };
+    static const char opposing_names[] = { 'C', 'N' };
+    char answer[96];
+    ST4_Policy_t policy = st4_get_policy();
+    ST4_Opposing_t opposing = st4_get_opposing();
+    const ST4_Guide_Stats_t* stats;
+
+    for(const char* c = &command[3]; (*c != '#') && (*c != '\0'); c++)
     {
-        // Move guide rate South with duration parameter
-        uint32_t duration = st4_parse_duration(command);
-        st4_set(ST4_SOUTH, duration);
-        strcpy(response, "");
+        switch(*c)
+        {
+            case 'R': policy = ST4_POLICY_REPLACE; break;
+            case 'E': policy = ST4_POLICY_EXTEND; break;
+            case 'Q': policy = ST4_POLICY_QUEUE; break;
+            case 'C': opposing = ST4_OPPOSING_CANCEL; break;
+            case 'N': opposing = ST4_OPPOSING_NET; break;
+            default: break;
+        }
     }
-    else if(strncmp(command, ":Mge", 4) == 0)
+    st4_set_policy(policy, opposing);
+
+    stats = st4_get_guide_stats();
+    snprintf(answer, sizeof(answer), "%c,%c,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu#",
+             policy_names[policy], opposing_names[opposing],
+             st4_queue_depth(ST4_AXIS_DEC), st4_queue_depth(ST4_AXIS_RA),
+             (unsigned long)stats->replaced, (unsigned long)stats->extended, (unsigned long)stats->queued,
+             (unsigned long)stats->dropped, (unsigned long)stats->netted, (unsigned long)stats->cancelled);
+    mount_reply_local(answer);
+    UART_Printf(UART_DEBUG, "-> %s: %s\r\n", entry->description, answer);
+}
+
+/**
+ * @brief :XW# main loop wait "passes,event_passes,wakeups,idle,latency_mean,latency_max#",
+ *        idle share of the last second in 0.1%, event to pass latency in us
+ */
+static void fs2_loop_status(const char* command, const lx200_command_t* entry)
+{
+    char answer[80];
+    const event_stats_t* stats = event_get_stats();
+    uint32_t mean_cycles = (stats->event_passes > 0) ? (uint32_t)(stats->latency_sum_cycles / stats->event_passes) : 0;
+
+    snprintf(answer, sizeof(answer), "%lu,%lu,%lu,%u,%lu,%lu#", (unsigned long)stats->passes,
+             (unsigned long)stats->event_passes, (unsigned long)stats->wakeups, stats->idle_permille,
+             (unsigned long)PERF_CYCLES_TO_US(mean_cycles),
+             (unsigned long)PERF_CYCLES_TO_US(stats->latency_max_cycles));
+    mount_reply_local(answer);
+    DEBUG_PRINTF(UART_DEBUG, "-> %s: %s\r\n", entry->description, answer);
+}
+
+/**
+ * @brief :XT# task table of the scheduler, see scheduler.c for the format
+ */
+static void fs2_task_status(const char* command, const lx200_command_t* entry)
+{
+    sched_format(dump, sizeof(dump));
+    mount_reply_local(dump);
+    DEBUG_PRINTF(UART_DEBUG, "-> %s\r\n", entry->description);
+}
+
+/**
+ * @brief :GM# :Gt# :Gg# :GT#, answered from the configuration store (RAM mirror)
+ */
+static void fs2_get_config(const char* command, const lx200_command_t* entry)
+{
+    mount_reply_local(config_reply((config_key_t)entry->arg));
+}
+
+/**
+ * @brief Value of a set command, from offset up to the '#', a leading space is skipped
+ * @retval length, CONFIG_VALUE_MAX_LEN + 1 if longer (rejected by config_set())
+ */
+static uint8_t fs2_config_value(const char* command, uint8_t offset, const char** value)
+{
+    const char* start = &command[offset];
+    const char* end;
+
+    if(*start == ' ')
     {
-        // Move guide rate East with duration parameter
-        uint32_t duration = st4_parse_duration(command);
-        st4_set(ST4_EAST, duration);
-        strcpy(response, "");
+        start++;
     }
-    else if(strncmp(command, ":Mgw", 4) == 0)
+    end = strchr(start, '#');
+    if(end == NULL)
     {
-        // Move guide rate West with duration parameter
-        uint32_t duration = st4_parse_duration(command);
-        st4_set(ST4_WEST, duration);
-        strcpy(response, "");
+        end = start + strlen(start);
     }
-    else
+    *value = start;
+    return (end - start > CONFIG_VALUE_MAX_LEN) ? CONFIG_VALUE_MAX_LEN + 1 : (uint8_t)(end - start);
+}
+
+/**
+ * @brief :SM :St :Sg :ST, not forwarded (the FS2 ignores them), stored by the proxy
+ */
+static void fs2_set_config(const char* command, const lx200_command_t* entry)
+{
+    const char* value;
+    uint8_t length = fs2_config_value(command, 3, &value);
+    uint8_t valid = config_set((config_key_t)entry->arg, value, length);
+
+    mount_reply_local(valid ? "1" : "0");
+    UART_Printf(UART_DEBUG, "-> %s %s\r\n", entry->description, valid ? "stored" : "rejected");
+}
+
+/**
+ * @brief :XC# configuration store, see config_store.c for the format,
+ *        :XCM / :XCt / :XCg / :XCT<value># set a value like the LX200 set command
+ *        of the same letter, :XCD# restores the defaults
+ */
+static void fs2_config(const char* command, const lx200_command_t* entry)
+{
+    static const char key_letters[CONFIG_KEYS] = { 'M', 't', 'g', 'T' };
+    char answer[96];
+
+    if(command[3] == 'D')
     {
-        /* not handled command, send direct to FS2 */
-        strcpy(response, "");
-        UART_Printf(UART_OUT, command);
-        UART_Printf(UART_DEBUG, "-> send to FS2\r\n");
+        config_defaults();
+        mount_reply_local("1");
+        UART_Printf(UART_DEBUG, "-> %s defaults\r\n", entry->description);
         return;
     }
-    
-    // Send response via USB CDC (if available)
-    if(strlen(response) > 0)
+    for(uint8_t key = 0; key < CONFIG_KEYS; key++)
     {
-        CDC_Transmit_FS((uint8_t*)response, strlen(response));
+        if(command[3] == key_letters[key])
+        {
+            const char* value;
+            uint8_t length = fs2_config_value(command, 4, &value);
+
+            mount_reply_local(config_set((config_key_t)key, value, length) ? "1" : "0");
+            return;
+        }
     }
+
+    config_format(answer, sizeof(answer));
+    mount_reply_local(answer);
+    DEBUG_PRINTF(UART_DEBUG, "-> %s: %s\r\n", entry->description, answer);
+}
+
+/* ----------------------------------------------------------------------------
+ *                         FS2 REWRITE RULES
+ * ---------------------------------------------------------------------------- */
+/* :Sr / :Sd, the FS2 must have a space character after the command */
+static const lx200_rule_t fs2_rule_space = { LX200_RULE_INSERT, 3, 0, " ", 0 };
+/* :MS# / :Q#, there is a bug in the FS2 that the command is aborted / not executed -> send two times */
+static const lx200_rule_t fs2_rule_twice = { LX200_RULE_KEEP, 0, 0, NULL, FS2_RESEND_DELAY_MS };
+
+/* ----------------------------------------------------------------------------
+ *                         FS2 COMMAND TABLE
+ * ---------------------------------------------------------------------------- */
+static const lx200_command_t fs2_commands[] = {
+    /* LX200 commands not supported by the FS2, kept in the configuration store */
+    { ":GM#", LX200_LOCAL,   fs2_get_config,         NULL,          CONFIG_SITE_NAME,     "Get Site Name" },
+    { ":Gt#", LX200_LOCAL,   fs2_get_config,         NULL,          CONFIG_LATITUDE,      "Get Site Latitude" },
+    { ":Gg#", LX200_LOCAL,   fs2_get_config,         NULL,          CONFIG_LONGITUDE,     "Get Site Longitude" },
+    { ":GT#", LX200_LOCAL,   fs2_get_config,         NULL,          CONFIG_TRACKING_RATE, "Get Tracking Rate" },
+    { ":SM",  LX200_LOCAL,   fs2_set_config,         NULL,          CONFIG_SITE_NAME,     "Set Site Name" },
+    { ":St",  LX200_LOCAL,   fs2_set_config,         NULL,          CONFIG_LATITUDE,      "Set Site Latitude" },
+    { ":Sg",  LX200_LOCAL,   fs2_set_config,         NULL,          CONFIG_LONGITUDE,     "Set Site Longitude" },
+    { ":ST",  LX200_LOCAL,   fs2_set_config,         NULL,          CONFIG_TRACKING_RATE, "Set Tracking Rate" },
+    /* Position queries, answered from the cache while fresh */
+    { ":GR#", LX200_FORWARD, fs2_get_position,       NULL,          FS2_AXIS_RA,  "Get RA",                   MOUNT_REPLY_HASH },
+    { ":GD#", LX200_FORWARD, fs2_get_position,       NULL,          FS2_AXIS_DEC, "Get DEC",                  MOUNT_REPLY_HASH },
+    /* FS2 workarounds */
+    { ":Sr",  LX200_REWRITE, fs2_send_target,        NULL,          FS2_AXIS_RA,  "Set RA",                   MOUNT_REPLY_CHAR, &fs2_rule_space },
+    { ":Sd",  LX200_REWRITE, fs2_send_target,        NULL,          FS2_AXIS_DEC, "Set DEC",                  MOUNT_REPLY_CHAR, &fs2_rule_space },
+    { ":MS#", LX200_REWRITE, fs2_forward_invalidate, NULL,          0,            "Move to target",           MOUNT_REPLY_GOTO, &fs2_rule_twice },
+    { ":Q#",  LX200_REWRITE, fs2_forward_invalidate, NULL,          0,            "Halt all movement",        MOUNT_REPLY_NONE, &fs2_rule_twice },
+    /* Commands moving the mount */
+    { ":CM#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Sync telescope",           MOUNT_REPLY_HASH },
+    { ":Mn#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Move North",               MOUNT_REPLY_NONE },
+    { ":Ms#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Move South",               MOUNT_REPLY_NONE },
+    { ":Me#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Move East",                MOUNT_REPLY_NONE },
+    { ":Mw#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Move West",                MOUNT_REPLY_NONE },
+    { ":Qn#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Halt North movement",      MOUNT_REPLY_NONE },
+    { ":Qs#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Halt South movement",      MOUNT_REPLY_NONE },
+    { ":Qe#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Halt East movement",       MOUNT_REPLY_NONE },
+    { ":Qw#", LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Halt West movement",       MOUNT_REPLY_NONE },
+    /* Slew rates, only sent when changed */
+    { ":RS#", LX200_FORWARD, fs2_set_rate,           NULL,          0,            "Set slew rate: Fastest",   MOUNT_REPLY_NONE },
+    { ":RM#", LX200_FORWARD, fs2_set_rate,           NULL,          0,            "Set slew rate: Medium",    MOUNT_REPLY_NONE },
+    { ":RC#", LX200_FORWARD, fs2_set_rate,           NULL,          0,            "Set slew rate: Centering", MOUNT_REPLY_NONE },
+    { ":RG#", LX200_FORWARD, fs2_set_rate,           NULL,          0,            "Set slew rate: Guiding",   MOUNT_REPLY_NONE },
+    /* Commands without reply */
+    { ":U#",  LX200_FORWARD, fs2_forward_invalidate, NULL,          0,            "Toggle precision mode",    MOUNT_REPLY_NONE },
+    /* Proxy extensions */
+    { ":XP",  LX200_LOCAL,   fs2_poller_status,      NULL,          0,            "Poller status" },
+    { ":XH",  LX200_LOCAL,   fs2_latency,            NULL,          0,            "Latency histograms" },
+    { ":XR",  LX200_LOCAL,   fs2_round_trip,         NULL,          0,            "Mount round trip times" },
+    { ":XS#", LX200_LOCAL,   fs2_statistics,         NULL,          0,            "Runtime statistics" },
+    { ":XA#", LX200_LOCAL,   fs2_st4_accuracy,       NULL,          0,            "ST4 pulse accuracy" },
+    { ":XG",  LX200_LOCAL,   fs2_guide_status,       NULL,          0,            "Guide pulse policy" },
+    { ":XW#", LX200_LOCAL,   fs2_loop_status,        NULL,          0,            "Main loop wait" },
+    { ":XT#", LX200_LOCAL,   fs2_task_status,        NULL,          0,            "Scheduler tasks" },
+    { ":XC",  LX200_LOCAL,   fs2_config,             NULL,          0,            "Configuration store" },
+    /* Guiding commands, will be mapped to ST4 output */
+    { ":Mgn", LX200_ST4,     NULL,                   NULL,          ST4_NORTH,    "Guide North" },
+    { ":Mgs", LX200_ST4,     NULL,                   NULL,          ST4_SOUTH,    "Guide South" },
+    { ":Mge", LX200_ST4,     NULL,                   NULL,          ST4_EAST,     "Guide East" },
+    { ":Mgw", LX200_ST4,     NULL,                   NULL,          ST4_WEST,     "Guide West" },
+};
+
+/* not handled commands are sent direct to the FS2 */
+static lx200_dispatch_table_t fs2_table = LX200_DISPATCH_TABLE(fs2_commands, LX200_FORWARD, fs2_forward, fs2_resend, mount_reply_local);
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/* ----------------------------------------------------------------------------
+ *                         FS2 COMMAND PROCESSOR
+ * ---------------------------------------------------------------------------- */
+void ProcessLX200Command_FS2(char* command)
+{
+    // Debug output of recognized command
+    UART_Printf(UART_DEBUG, "%s\r\n", command);
+
+    lx200_dispatch(&fs2_table, command);
 }
@@ -0,0 +1,191 @@
+/*
+ ******************************************************************************
+ * @file    lx200_latency.c
+ * @brief   Per command latency histograms (DWT cycle counter)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Every command is timestamped at USB reception, dispatch, when its last
+ * byte left USART2 (forwarded commands) and when the response was passed to
+ * USB. The latencies are counted in log2 scaled histograms per command class
+ * (dispatch action) and stage.
+ *
+ * :XH# dump, one row per class and stage with counts, trailing zeros cut:
+ *   "<class><stage>:<bucket 0>,<bucket 1>,...;" ... "#"
+ *   class: L local, W rewrite, F forward, S ST4, U unknown
+ *   stage: Q queue, P proxy, F forward, R response
+ * Rows that do not fit into one answer are left out and it ends with "+#",
+ * :XH<class># returns the rows of one class.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+#include "perf_counter.h"
+#include "lx200_latency.h"
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static uint32_t histogram[LX200_LATENCY_CLASSES][LX200_STAGES][LX200_LATENCY_BUCKETS];
+
+/* command currently dispatched */
+static lx200_timing_t current;
+static uint8_t current_responded = 0;
+
+static const char class_names[LX200_LATENCY_CLASSES] = { 'L', 'W', 'F', 'S', 'U' };
+static const char stage_names[LX200_STAGES] = { 'Q', 'P', 'F', 'R' };
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint8_t latency_bucket(uint32_t cycles)
+{
+    uint32_t us = PERF_CYCLES_TO_US(cycles);
+    uint8_t bucket = (us == 0) ? 0 : (uint8_t)(32 - __CLZ(us));
+
+    return (bucket < LX200_LATENCY_BUCKETS) ? bucket : (LX200_LATENCY_BUCKETS - 1);
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief A complete command is dispatched
+ * @param rx_cycles: cycle counter when its last USB packet was received
+ */
+void lx200_latency_begin(uint32_t rx_cycles)
+{
+    current.rx = rx_cycles;
+    current.dispatch = perf_cycles();
+    current.cls = LX200_LATENCY_UNKNOWN;
+    current.valid = 1;
+    current_responded = 0;
+}
+
+/**
+ * @brief Class of the command currently dispatched
+ */
+void lx200_latency_class(uint8_t cls)
+{
+    current.cls = (cls < LX200_LATENCY_CLASSES) ? cls : LX200_LATENCY_UNKNOWN;
+}
+
+/**
+ * @brief Dispatch of the current command finished
+ */
+void lx200_latency_end(void)
+{
+    if(current.valid)
+    {
+        lx200_latency_record(&current, LX200_STAGE_QUEUE, current.dispatch);
+        lx200_latency_record(&current, LX200_STAGE_PROXY, perf_cycles());
+        current.valid = 0;
+    }
+}
+
+/**
+ * @brief The proxy answered the current command itself
+ */
+void lx200_latency_responded(void)
+{
+    if(current.valid && !current_responded)
+    {
+        lx200_latency_record(&current, LX200_STAGE_RESPONSE, perf_cycles());
+        current_responded = 1;
+    }
+}
+
+/**
+ * @brief The answer of the current command is sent later, its timestamps are
+ *        returned once, valid is 0 for further parts of the answer
+ */
+lx200_timing_t lx200_latency_respond_later(void)
+{
+    lx200_timing_t timing = current;
+
+    timing.valid = current.valid && !current_responded;
+    current_responded = 1;
+    return timing;
+}
+
+/**
+ * @brief Timestamps of the current command, valid is 0 outside of dispatch
+ */
+lx200_timing_t lx200_latency_current(void)
+{
+    return current;
+}
+
+/**
+ * @brief Count the latency of a stage
+ * @param end_cycles: cycle counter at the end of the stage
+ */
+void lx200_latency_record(const lx200_timing_t* timing, lx200_stage_t stage, uint32_t end_cycles)
+{
+    uint32_t start = ((stage == LX200_STAGE_QUEUE) || (stage == LX200_STAGE_RESPONSE)) ? timing->rx : timing->dispatch;
+
+    if(timing->valid && (timing->cls < LX200_LATENCY_CLASSES) && (stage < LX200_STAGES))
+    {
+        histogram[timing->cls][stage][latency_bucket(end_cycles - start)]++;
+    }
+}
+
+void lx200_latency_reset(void)
+{
+    memset(histogram, 0, sizeof(histogram));
+}
+
+/**
+ * @brief Histograms with counts as one answer, see the file header for the format
+ * @param class_name: letter of the class to format, '\0' for all classes
+ */
+void lx200_latency_format(char* buffer, uint16_t size, char class_name)
+{
+    char line[256];
+    uint16_t used = 0;
+    uint8_t full = 0;
+
+    for(uint8_t cls = 0; (cls < LX200_LATENCY_CLASSES) && !full; cls++)
+    {
+        if((class_name != '\0') && (class_names[cls] != class_name))
+        {
+            continue;
+        }
+        for(uint8_t stage = 0; (stage < LX200_STAGES) && !full; stage++)
+        {
+            const uint32_t* counts = histogram[cls][stage];
+            int8_t last = LX200_LATENCY_BUCKETS - 1;
+
+            while((last >= 0) && (counts[last] == 0))
+            {
+                last--;
+            }
+            if(last < 0)
+            {
+                continue;
+            }
+
+            int len = snprintf(line, sizeof(line), "%c%c:", class_names[cls], stage_names[stage]);
+            for(int8_t b = 0; (b <= last) && (len < (int)sizeof(line)); b++)
+            {
+                len += snprintf(&line[len], sizeof(line) - len, "%lu%c", (unsigned long)counts[b], (b == last) ? ';' : ',');
+            }
+            // room for "+#" and the terminator
+            if(used + strlen(line) + 3 > size)
+            {
+                full = 1;
+                break;
+            }
+            memcpy(&buffer[used], line, strlen(line));
+            used += strlen(line);
+        }
+    }
+    snprintf(&buffer[used], size - used, "%s", full ? "+#" : "#");
+}
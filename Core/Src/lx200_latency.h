@@ -0,0 +1,60 @@
+/*
+ ******************************************************************************
+ * @file    lx200_latency.h
+ * @brief   Header for per command latency histograms (DWT cycle counter)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef LX200_LATENCY_H
+#define LX200_LATENCY_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* command classes: the lx200_action_t of the table row, and not in the table */
+#define LX200_LATENCY_UNKNOWN   4
+#define LX200_LATENCY_CLASSES   5
+/* bucket n counts latencies of 2^(n-1) .. 2^n us, the last one everything above */
+#define LX200_LATENCY_BUCKETS   20
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef enum {
+    LX200_STAGE_QUEUE = 0,      // USB reception -> dispatch
+    LX200_STAGE_PROXY,          // dispatch -> command handled by the proxy
+    LX200_STAGE_FORWARD,        // dispatch -> last byte sent to the mount
+    LX200_STAGE_RESPONSE,       // USB reception -> response passed to USB
+    LX200_STAGES
+} lx200_stage_t;
+
+/* timestamps of one command, copied along with forwarded commands */
+typedef struct {
+    uint32_t rx;                // cycles at USB reception
+    uint32_t dispatch;          // cycles at dispatch
+    uint8_t cls;
+    uint8_t valid;
+} lx200_timing_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void lx200_latency_begin(uint32_t rx_cycles);
+void lx200_latency_class(uint8_t cls);
+void lx200_latency_end(void);
+void lx200_latency_responded(void);
+lx200_timing_t lx200_latency_respond_later(void);
+lx200_timing_t lx200_latency_current(void);
+void lx200_latency_record(const lx200_timing_t* timing, lx200_stage_t stage, uint32_t end_cycles);
+void lx200_latency_reset(void);
+void lx200_latency_format(char* buffer, uint16_t size, char class_name);
+
+#endif // LX200_LATENCY_H
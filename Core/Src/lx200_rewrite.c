@@ -0,0 +1,111 @@
+/*
+ ******************************************************************************
+ * @file    lx200_rewrite.c
+ * @brief   Rewrite rules of mount dialects, applied in one pass
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * A rule belongs to a row of a dispatch table, the hashed prefix lookup of
+ * the dispatcher selects it. The rewritten command is written once into the
+ * output buffer: the bytes before the offset, the new text, the rest of the
+ * command behind the replaced characters. Nothing is copied twice, commands
+ * the rule does not change are not copied at all.
+ *
+ * Sending, the repetition after repeat_ms and RESPOND are done by the
+ * dispatcher, see lx200_dispatch().
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <string.h>
+#include "lx200_rewrite.h"
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Text is already at the position (INSERT is applied only once)
+ */
+static uint8_t lx200_rewrite_present(const char* position, const char* text)
+{
+    while(*text != '\0')
+    {
+        if(*position++ != *text++)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Rewrite a command according to a rule
+ * @param rule: INSERT, REPLACE or KEEP
+ * @param command: complete command string
+ * @param out: buffer for the rewritten command
+ * @param size: size of out
+ * @retval command if the rule leaves it unchanged (KEEP, text already inserted,
+ *         command shorter than the offset), out if rewritten, NULL if it does not fit
+ */
+const char* lx200_rewrite_apply(const lx200_rule_t* rule, const char* command, char* out, uint16_t size)
+{
+    uint16_t n;
+
+    if(rule->op == LX200_RULE_KEEP)
+    {
+        return command;
+    }
+
+    for(n = 0; n < rule->offset; n++)
+    {
+        if(command[n] == '\0')
+        {
+            return command;
+        }
+        if(n + 1 >= size)
+        {
+            return NULL;
+        }
+        out[n] = command[n];
+    }
+
+    const char* in = &command[n];
+
+    if((rule->op == LX200_RULE_INSERT) && lx200_rewrite_present(in, rule->text))
+    {
+        return command;
+    }
+
+    for(const char* text = rule->text; *text != '\0'; text++)
+    {
+        if(n + 1 >= size)
+        {
+            return NULL;
+        }
+        out[n++] = *text;
+    }
+
+    // replaced characters, not beyond the end of the command
+    for(uint8_t skip = (rule->op == LX200_RULE_REPLACE) ? rule->length : 0; (skip > 0) && (*in != '\0'); skip--)
+    {
+        in++;
+    }
+
+    for(; *in != '\0'; in++)
+    {
+        if(n + 1 >= size)
+        {
+            return NULL;
+        }
+        out[n++] = *in;
+    }
+    out[n] = '\0';
+    return out;
+}
@@ -0,0 +1,49 @@
+/*
+ ******************************************************************************
+ * @file    lx200_rewrite.h
+ * @brief   Header for the rewrite rules of mount dialects
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef LX200_REWRITE_H
+#define LX200_REWRITE_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* longest rewritten command incl. NUL */
+#define LX200_REWRITE_MAX_LEN   64
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef enum {
+    LX200_RULE_KEEP = 0,        // command is sent unchanged (only repeat_ms)
+    LX200_RULE_INSERT,          // text is inserted at offset, unless it is there already
+    LX200_RULE_REPLACE,         // length characters at offset are replaced by text
+    LX200_RULE_RESPOND          // text is the reply, nothing is sent
+} lx200_rule_op_t;
+
+/* one const rule per table row, matched by the prefix of the row */
+typedef struct {
+    lx200_rule_op_t op;
+    uint8_t offset;             // INSERT / REPLACE: position in the command
+    uint8_t length;             // REPLACE: characters replaced
+    const char* text;           // inserted / new characters, RESPOND: reply
+    uint16_t repeat_ms;         // > 0: sent once more after this delay, reply consumed
+} lx200_rule_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+const char* lx200_rewrite_apply(const lx200_rule_t* rule, const char* command, char* out, uint16_t size);
+
+#endif // LX200_REWRITE_H
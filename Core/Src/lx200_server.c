@@ -18,17 +18,36 @@
 #include "st4_handler.h"
 #include "lx200_emulator.h"
 #include "lx200_fs2_adapter.h" 
+#include "lx200_server.h"
+#include "spsc_queue.h"
+#include "perf_counter.h"
+#include "lx200_latency.h"
+#include "mount_reply.h"
 
 /* ============================================================================
  *                         PRIVATE DEFINES
  * ============================================================================ */
 #define LX200_CMD_BUFFER_SIZE 64
+#define LX200_RX_QUEUE_SIZE   512   // must be a power of two
+#define LX200_RX_PACKET_SIZE  64    // USB full speed bulk packet
+#define LX200_RX_STAMPS       16    // must be a power of two
 
 /* ============================================================================
  *                         PRIVATE VARIABLES
  * ============================================================================ */
 static char lx200_cmd_buffer[LX200_CMD_BUFFER_SIZE];
 
+/* data received via USB, filled in the USB interrupt, parsed in the main loop */
+static uint8_t lx200_rx_storage[LX200_RX_QUEUE_SIZE];
+static spsc_queue_t lx200_rx_queue = { lx200_rx_storage, LX200_RX_QUEUE_SIZE - 1, 0, 0 };
+static LX200_Stats_t lx200_stats = {0};
+
+/* reception time of the queued packets */
+static spsc_stamp_t lx200_rx_stamp_storage[LX200_RX_STAMPS];
+static spsc_stamps_t lx200_rx_stamps = { lx200_rx_stamp_storage, LX200_RX_STAMPS - 1, 0, 0 };
+/* reception time of the data currently parsed */
+static uint32_t lx200_rx_cycles = 0;
+
 /* ============================================================================
  *                         PRIVATE FUNCTION PROTOTYPES
  * ============================================================================ */
@@ -45,6 +64,59 @@ void ProcessLX200Command(char* command)
     ProcessLX200Command_FS2(command);
 }
 
+/* ----------------------------------------------------------------------------
+ *                         USB RECEIVE QUEUE
+ * ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Queue data received via USB (called in USB interrupt context)
+ * @param data: received packet
+ * @param length: packet length
+ * @retval 1 if there is room for more packets, 0 if reception must pause
+ * @note  the double buffered endpoint may deliver one more packet after pausing,
+ *        so reception pauses while less than two packets fit
+ */
+uint8_t QueueLX200Data(uint8_t* data, uint32_t length)
+{
+    if(!spsc_push(&lx200_rx_queue, data, length))
+    {
+        lx200_stats.queue_overflows++;
+    }
+    else
+    {
+        lx200_stats.rx_bytes += length;
+        spsc_stamp(&lx200_rx_stamps, &lx200_rx_queue, perf_cycles());
+    }
+
+    return (spsc_free(&lx200_rx_queue) >= 2 * LX200_RX_PACKET_SIZE) ? 1 : 0;
+}
+
+/**
+ * @brief Parse and dispatch all queued data (called from the main loop)
+ */
+void ProcessLX200Queue(void)
+{
+    uint8_t chunk[LX200_RX_PACKET_SIZE];
+    uint32_t limit;
+    uint32_t length;
+
+    do
+    {
+        // parse packet by packet, so every command gets the time of its packet
+        limit = spsc_stamp_limit(&lx200_rx_stamps, &lx200_rx_queue, sizeof(chunk), &lx200_rx_cycles);
+        length = spsc_pop(&lx200_rx_queue, chunk, limit);
+        if(length > 0)
+        {
+            ParseLX200Data(chunk, length);
+        }
+    } while(length > 0);
+}
+
+const LX200_Stats_t* GetLX200Stats(void)
+{
+    return &lx200_stats;
+}
+
 /* ----------------------------------------------------------------------------
  *                         LX200 COMMAND PARSER
  * ---------------------------------------------------------------------------- */
@@ -70,7 +142,10 @@ void ParseLX200Data(uint8_t* data, uint32_t length)
                 if(current_char == '#')
                 {
                     lx200_cmd_buffer[lx200_cmd_index] = '\0'; // Terminate string
+                    lx200_stats.commands++;
+                    lx200_latency_begin(lx200_rx_cycles);
                     ProcessLX200Command(lx200_cmd_buffer); // Process command
+                    lx200_latency_end();
                     
                     // Reset for next command
                     lx200_cmd_started = 0;
@@ -80,6 +155,7 @@ void ParseLX200Data(uint8_t* data, uint32_t length)
             else
             {
                 // Buffer overflow - command too long, reset
+                lx200_stats.parser_overflows++;
                 lx200_cmd_started = 0;
                 lx200_cmd_index = 0;
             }
@@ -95,9 +171,8 @@ void ParseLX200Data(uint8_t* data, uint32_t length)
         else if(current_char == 0x06)
         {
             UART_Printf(UART_DEBUG, "ACK (0x06) received\r\n");
-            // Send response directly: "G" for Autostar/LX200GPS
-            char ack_response[] = "G";
-            CDC_Transmit_FS((uint8_t*)ack_response, strlen(ack_response));
+            // "G" for Autostar/LX200GPS, behind pending client replies
+            mount_reply_local("G");
             UART_Printf(UART_DEBUG, "-> ACK Response: G\r\n");
             continue; // Process next character
         }
@@ -0,0 +1,39 @@
+/*
+ ******************************************************************************
+ * @file    lx200_server.h
+ * @brief   Header for LX200 protocol handler and command processor
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef LX200_SERVER_H
+#define LX200_SERVER_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef struct {
+    uint32_t rx_bytes;          // bytes received via USB
+    uint32_t commands;          // complete commands parsed
+    uint32_t parser_overflows;  // commands too long for the command buffer
+    uint32_t queue_overflows;   // USB packets lost, receive queue full
+} LX200_Stats_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void ProcessLX200Command(char* command);
+void ParseLX200Data(uint8_t* data, uint32_t length);
+
+uint8_t QueueLX200Data(uint8_t* data, uint32_t length);
+void ProcessLX200Queue(void);
+const LX200_Stats_t* GetLX200Stats(void);
+
+#endif // LX200_SERVER_H
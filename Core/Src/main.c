@@ -28,6 +28,15 @@
 #include <stdarg.h>
 
 #include "st4_handler.h"
+#include "mount_link.h"
+#include "mount_reply.h"
+#include "mount_poller.h"
+#include "lx200_server.h"
+#include "perf_counter.h"
+#include "scheduler.h"
+#include "event_loop.h"
+#include "mount_rtt.h"
+#include "config_store.h"
 
 /* USER CODE END Includes */
 
@@ -38,7 +47,7 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+#define LED_BLINK_MS    500
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -50,47 +59,69 @@
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
 UART_HandleTypeDef huart3;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 /* USER CODE BEGIN PV */
-// UART1 receive buffer for forwarding to USB VCP
-uint8_t uart2_rx_buffer[1];
+extern volatile uint32_t usb_isr_max_cycles;
+
+/* longest main loop iteration (without the idle wait) */
+volatile uint32_t main_loop_max_cycles = 0;
+/* bytes written to the debug UART */
+uint32_t debug_tx_bytes = 0;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_USART3_UART_Init(void);
 static void MX_USART1_UART_Init(void);
 /* USER CODE BEGIN PFP */
 
-extern void ParseLX200Data(uint8_t* data, uint32_t length);
-
-// Timer functions
-void toogleLED_callback(void);
+// Scheduler tasks
+static void ToggleLED(void* context);
+static void ReportISRTiming(void* context);
+static uint32_t NextDeadlineMs(void);
 void HAL_SYSTICK_Callback(void);
 
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
-// UART1 Receive Complete Callback - forwards data to USB VCP
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+/* background tasks of the main loop */
+static const sched_task_t led_task = { "led", ToggleLED, LED_BLINK_MS, 20 };
+/* a new maximum is printed, ~40 characters on the 115200 baud debug UART */
+static const sched_task_t isr_report_task = { "isr", ReportISRTiming, 1000, 5000 };
+
+// UART2 Reception Event Callback (IDLE line, half or full DMA buffer) - forwards data to USB VCP
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
 {
     if(huart == UART_OUT)
     {
-        // Forward received character via USB VCP
-        CDC_Transmit_FS(uart2_rx_buffer, 1);
-        
-        // Debug output via UART3
-        DEBUG_PRINTF(UART_DEBUG, "[%c]", uart2_rx_buffer[0]);
-        if(uart2_rx_buffer[0] == '#')
-        {
-            DEBUG_PRINTF(UART_DEBUG, "\r\n");
-        }
-        
-        // Receive next character
-        HAL_UART_Receive_IT(UART_OUT, uart2_rx_buffer, 1);
+        mount_link_rx_event(Size);
+        event_post(EVENT_MOUNT_RX);
+    }
+}
+
+// UART Transmit Complete Callback - continues with the next queued data for the mount
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if(huart == UART_OUT)
+    {
+        mount_link_tx_complete();
+        event_post(EVENT_MOUNT_TX);
+    }
+}
+
+// UART Error Callback - restarts the mount reception
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if(huart == UART_OUT)
+    {
+        mount_link_error();
+        event_post(EVENT_MOUNT_RX);
     }
 }
 
@@ -108,6 +139,10 @@ void UART_Printf(UART_HandleTypeDef *huart, const char *format, ...)
     if(len > 0 && len < sizeof(buffer))
     {
         HAL_UART_Transmit(huart, (uint8_t*)buffer, len, HAL_MAX_DELAY);
+        if(huart == UART_DEBUG)
+        {
+            debug_tx_bytes += len;
+        }
     }
 }
 /* USER CODE END 0 */
@@ -120,7 +155,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  char config_text[96];
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -129,7 +164,7 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-
+  perf_init();
   /* USER CODE END Init */
 
   /* Configure the system clock */
@@ -137,10 +172,13 @@ int main(void)
 
   /* USER CODE BEGIN SysInit */
 
+  // site and tracking rate from the emulated EEPROM, page erases before USB enumerates
+  config_init();
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_USART2_UART_Init();
   MX_USART3_UART_Init();
   MX_USB_DEVICE_Init();
@@ -151,17 +189,39 @@ int main(void)
   UART_Printf(UART_DEBUG, "LX200 Proxy by Sven Lissel 2025\r\n");
   UART_Printf(UART_DEBUG, "Mount on UART2 @ %d Baud\r\n", huart2.Init.BaudRate); 
   
-  // Start UART1 reception (interrupt-based)
-  HAL_UART_Receive_IT(UART_OUT, uart2_rx_buffer, 1);
+  // Start UART2 reception (circular DMA with IDLE line detection)
+  mount_link_init();
+
+  // ST4 pulse lengths from TIM2 compare interrupts
+  st4_init();
+
+  // configuration loaded in SysInit
+  config_format(config_text, sizeof(config_text));
+  UART_Printf(UART_DEBUG, "Config %s\r\n", config_text);
+
+  // background tasks of the main loop
+  mount_poller_init();
+  mount_rtt_init();
+  sched_start(&led_task, LED_BLINK_MS, NULL);
+  sched_start(&isr_report_task, 1000, NULL);
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
   while (1)
   {
-    st4_process();
-    toogleLED_callback();
-    HAL_Delay(1);
+    uint32_t loop_start = perf_cycles();
+
+    ProcessLX200Queue();
+    st4_commit();
+    CDC_ResumeReceive_FS();
+    mount_reply_process();
+    mount_poller_process();
+    sched_process();
+    perf_track_max(&main_loop_max_cycles, loop_start);
+
+    // sleep until an interrupt posts work or the nearest deadline
+    event_wait(NextDeadlineMs());
 
     /* USER CODE END WHILE */
 
@@ -315,6 +375,25 @@ static void MX_USART3_UART_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Channel6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel6_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+  /* DMA1_Channel7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel7_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
@@ -360,28 +439,65 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
-void USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len)
+/**
+ * @brief  USB receive handler, called in USB interrupt context
+ * @note   Only queues the data, parsing is done in the main loop
+ * @retval 1 if the endpoint can be re-armed, 0 if the queue is full
+ */
+uint8_t USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len)
 {
-    // Parse the received data for LX200 commands
-    ParseLX200Data(Buf, Len);
+    uint8_t result = QueueLX200Data(Buf, Len);
+
+    event_post(EVENT_USB_RX);
+    return result;
 }
 
 /**
- * @brief  1ms Timer Callback Function
- * @note   This function is called every 1ms
- * @retval None
+ * @brief  Report a new worst case USB interrupt duration on the debug UART
  */
-void toogleLED_callback(void)
+static void ReportISRTiming(void* context)
 {
-    static uint32_t ms_counter = 0;
+    static uint32_t reported_cycles = 0;
+    uint32_t max_cycles = usb_isr_max_cycles;
 
-    ms_counter++;
+    if(max_cycles > reported_cycles)
+    {
+        reported_cycles = max_cycles;
+        UART_Printf(UART_DEBUG, "USB ISR max: %lu cycles (%lu us)\r\n",
+                    (unsigned long)max_cycles, (unsigned long)PERF_CYCLES_TO_US(max_cycles));
+    }
+}
+
+/**
+ * @brief  Blink the LED, the scheduler keeps the period without drift
+ */
+static void ToggleLED(void* context)
+{
+    HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);  // Built-in LED toggle
+}
 
-    // Blink LED every 500ms (1 second)
-    if (ms_counter % 500 == 0)
+/**
+ * @brief  Time until the nearest deadline of the main loop modules
+ * @note   Interrupt work wakes the loop earlier by an event
+ * @retval ms to sleep at most
+ */
+static uint32_t NextDeadlineMs(void)
+{
+    uint32_t deadlines[] = {
+        mount_reply_next_ms(),
+        mount_poller_next_ms(),
+        sched_next_ms(),
+    };
+    uint32_t next = EVENT_MAX_SLEEP_MS;
+
+    for(uint8_t i = 0; i < sizeof(deadlines) / sizeof(deadlines[0]); i++)
     {
-        HAL_GPIO_TogglePin(LED_GPIO_Port, LED_Pin);  // Built-in LED toggle
+        if(deadlines[i] < next)
+        {
+            next = deadlines[i];
+        }
     }
+    return next;
 }
 
 /* USER CODE END 4 */
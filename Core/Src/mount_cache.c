@@ -0,0 +1,266 @@
+/*
+ ******************************************************************************
+ * @file    mount_cache.c
+ * @brief   RA/DEC position cache of the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * The replies of :GR# and :GD# are parsed into fixed point values (RA in ms
+ * of time, DEC in arc seconds). While fresh, polls are answered from the
+ * cache in the format the mount used (high or low precision).
+ *
+ * The FS2 always tracks: the mount follows the sky and the cached RA stays
+ * valid without extrapolation.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include "main.h"
+#include "mount_cache.h"
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    int32_t value;          // RA: ms of time, DEC: arc seconds
+    uint32_t tick;          // HAL tick of the mount reply
+    uint8_t valid;
+    uint8_t high_precision; // reply had seconds
+    char separator;         // DEC: degree separator used by the mount
+} cache_entry_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static cache_entry_t ra_cache;
+static cache_entry_t dec_cache;
+static uint32_t cache_generation = 0;
+static mount_cache_stats_t cache_stats;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Read a decimal number, p is moved behind the digits
+ * @retval number of digits
+ */
+static uint8_t parse_number(const char** p, uint32_t* value)
+{
+    uint8_t digits = 0;
+
+    *value = 0;
+    while((**p >= '0') && (**p <= '9'))
+    {
+        *value = *value * 10 + (uint32_t)(**p - '0');
+        (*p)++;
+        digits++;
+    }
+    return digits;
+}
+
+/**
+ * @brief Entry is valid and not older than MOUNT_CACHE_MAX_AGE_MS
+ */
+static uint8_t cache_fresh(const cache_entry_t* entry)
+{
+    if(!entry->valid || ((HAL_GetTick() - entry->tick) > MOUNT_CACHE_MAX_AGE_MS))
+    {
+        cache_stats.misses++;
+        return 0;
+    }
+    cache_stats.hits++;
+    return 1;
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Store the reply of :GR#, "HH:MM:SS#" or "HH:MM.T#"
+ * @param generation: mount_cache_generation() when the command was sent
+ */
+void mount_cache_update_ra(const char* reply, uint32_t generation)
+{
+    const char* p = reply;
+    uint32_t hours, minutes, seconds = 0;
+    uint8_t high_precision = 0;
+    int32_t ms;
+
+    if((reply == NULL) || (generation != cache_generation))
+    {
+        return; // timeout or mount moved in between
+    }
+
+    if(!parse_number(&p, &hours) || (*p++ != ':') || !parse_number(&p, &minutes))
+    {
+        return;
+    }
+    if(*p == ':')
+    {
+        p++;
+        if(!parse_number(&p, &seconds))
+        {
+            return;
+        }
+        ms = (int32_t)((hours * 3600 + minutes * 60 + seconds) * 1000);
+        high_precision = 1;
+    }
+    else if(*p == '.')
+    {
+        p++;
+        if(!parse_number(&p, &seconds))
+        {
+            return;
+        }
+        ms = (int32_t)((hours * 3600 + minutes * 60) * 1000 + seconds * 6000);
+    }
+    else
+    {
+        return;
+    }
+    if((hours > 23) || (minutes > 59) || (*p != '#'))
+    {
+        return;
+    }
+
+    ra_cache.value = ms;
+    ra_cache.high_precision = high_precision;
+    ra_cache.tick = HAL_GetTick();
+    ra_cache.valid = 1;
+    cache_stats.updates++;
+}
+
+/**
+ * @brief Store the reply of :GD#, "sDD*MM:SS#" or "sDD*MM#"
+ * @param generation: mount_cache_generation() when the command was sent
+ */
+void mount_cache_update_dec(const char* reply, uint32_t generation)
+{
+    const char* p = reply;
+    uint32_t degrees, minutes, seconds = 0;
+    uint8_t high_precision = 0;
+    int32_t sign = 1;
+    char separator;
+
+    if((reply == NULL) || (generation != cache_generation))
+    {
+        return;
+    }
+
+    if((*p == '+') || (*p == '-'))
+    {
+        sign = (*p++ == '-') ? -1 : 1;
+    }
+    if(!parse_number(&p, &degrees))
+    {
+        return;
+    }
+    separator = *p++;   // '*' or the degree sign 0xDF
+    if((separator == '#') || !parse_number(&p, &minutes))
+    {
+        return;
+    }
+    if(*p == ':')
+    {
+        p++;
+        if(!parse_number(&p, &seconds))
+        {
+            return;
+        }
+        high_precision = 1;
+    }
+    if((degrees > 90) || (minutes > 59) || (seconds > 59) || (*p != '#'))
+    {
+        return;
+    }
+
+    dec_cache.value = sign * (int32_t)(degrees * 3600 + minutes * 60 + seconds);
+    dec_cache.high_precision = high_precision;
+    dec_cache.separator = separator;
+    dec_cache.tick = HAL_GetTick();
+    dec_cache.valid = 1;
+    cache_stats.updates++;
+}
+
+/**
+ * @brief Format the cached RA as mount reply
+ * @retval 1 if out holds a reply, 0 if the cache is not fresh
+ */
+uint8_t mount_cache_get_ra(char* out, uint8_t size)
+{
+    if(!cache_fresh(&ra_cache))
+    {
+        return 0;
+    }
+
+    uint32_t ms = (uint32_t)ra_cache.value;
+    uint32_t seconds = ms / 1000;
+
+    if(ra_cache.high_precision)
+    {
+        snprintf(out, size, "%02lu:%02lu:%02lu#",
+                 (unsigned long)(seconds / 3600), (unsigned long)((seconds / 60) % 60), (unsigned long)(seconds % 60));
+    }
+    else
+    {
+        snprintf(out, size, "%02lu:%02lu.%01lu#",
+                 (unsigned long)(seconds / 3600), (unsigned long)((seconds / 60) % 60), (unsigned long)((ms % 60000) / 6000));
+    }
+    return 1;
+}
+
+/**
+ * @brief Format the cached DEC as mount reply
+ * @retval 1 if out holds a reply, 0 if the cache is not fresh
+ */
+uint8_t mount_cache_get_dec(char* out, uint8_t size)
+{
+    if(!cache_fresh(&dec_cache))
+    {
+        return 0;
+    }
+
+    char sign = (dec_cache.value < 0) ? '-' : '+';
+    uint32_t arcsec = (uint32_t)((dec_cache.value < 0) ? -dec_cache.value : dec_cache.value);
+
+    if(dec_cache.high_precision)
+    {
+        snprintf(out, size, "%c%02lu%c%02lu:%02lu#", sign, (unsigned long)(arcsec / 3600), dec_cache.separator,
+                 (unsigned long)((arcsec / 60) % 60), (unsigned long)(arcsec % 60));
+    }
+    else
+    {
+        snprintf(out, size, "%c%02lu%c%02lu#", sign, (unsigned long)(arcsec / 3600), dec_cache.separator,
+                 (unsigned long)((arcsec / 60) % 60));
+    }
+    return 1;
+}
+
+/**
+ * @brief Current generation, replies of older generations are dropped
+ */
+uint32_t mount_cache_generation(void)
+{
+    return cache_generation;
+}
+
+/**
+ * @brief Clear the cache, called for all commands moving the mount
+ */
+void mount_cache_invalidate(void)
+{
+    ra_cache.valid = 0;
+    dec_cache.valid = 0;
+    cache_generation++;
+    cache_stats.invalidations++;
+}
+
+const mount_cache_stats_t* mount_cache_get_stats(void)
+{
+    return &cache_stats;
+}
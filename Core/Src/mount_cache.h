@@ -0,0 +1,48 @@
+/*
+ ******************************************************************************
+ * @file    mount_cache.h
+ * @brief   Header for the RA/DEC position cache of the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef MOUNT_CACHE_H
+#define MOUNT_CACHE_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* cached positions older than this are refreshed from the mount */
+#ifndef MOUNT_CACHE_MAX_AGE_MS
+#define MOUNT_CACHE_MAX_AGE_MS  1000
+#endif
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef struct {
+    uint32_t hits;              // polls answered from the cache
+    uint32_t misses;            // polls forwarded to the mount
+    uint32_t updates;           // positions parsed from mount replies
+    uint32_t invalidations;     // cache cleared by a movement command
+} mount_cache_stats_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void mount_cache_update_ra(const char* reply, uint32_t generation);
+void mount_cache_update_dec(const char* reply, uint32_t generation);
+uint8_t mount_cache_get_ra(char* out, uint8_t size);
+uint8_t mount_cache_get_dec(char* out, uint8_t size);
+uint32_t mount_cache_generation(void);
+void mount_cache_invalidate(void);
+const mount_cache_stats_t* mount_cache_get_stats(void);
+
+#endif // MOUNT_CACHE_H
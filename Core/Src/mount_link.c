@@ -0,0 +1,308 @@
+/*
+ ******************************************************************************
+ * @file    mount_link.c
+ * @brief   UART2 link to the telescope mount (DMA based)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <string.h>
+#include "main.h"
+#include "mount_link.h"
+#include "spsc_queue.h"
+#include "perf_counter.h"
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+/* circular DMA buffer, written by DMA1 channel 6, never stopped */
+static uint8_t rx_dma_buffer[MOUNT_LINK_RX_DMA_SIZE];
+/* position up to which the buffer was already handed off */
+static uint16_t rx_read_pos = 0;
+
+/* received bursts, framed and routed in the main loop */
+static uint8_t rx_queue_storage[MOUNT_LINK_RX_QUEUE_SIZE];
+static spsc_queue_t rx_queue = { rx_queue_storage, MOUNT_LINK_RX_QUEUE_SIZE - 1, 0, 0 };
+/* reception time of the bursts */
+static spsc_stamp_t rx_stamp_storage[MOUNT_LINK_STAMPS];
+static spsc_stamps_t rx_stamps = { rx_stamp_storage, MOUNT_LINK_STAMPS - 1, 0, 0 };
+
+/* transmit queue, head written by mount_link_send, tail by the DMA completion */
+static uint8_t tx_queue[MOUNT_LINK_TX_QUEUE_SIZE];
+static volatile uint32_t tx_head = 0;
+static volatile uint32_t tx_tail = 0;
+/* bytes of the queue currently owned by the DMA */
+static volatile uint16_t tx_in_flight = 0;
+/* completed transfers: end = queue position after the transfer, cycles = last byte left */
+static spsc_stamp_t tx_done_storage[MOUNT_LINK_STAMPS];
+static volatile uint32_t tx_done_head = 0;
+static volatile uint32_t tx_done_tail = 0;
+
+static mount_link_stats_t link_stats = {0};
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Hand off a contiguous block of received mount data
+ * @param data: pointer into the DMA buffer
+ * @param length: number of bytes
+ */
+static void mount_link_handoff(uint8_t* data, uint16_t length)
+{
+    link_stats.rx_bytes += length;
+
+    // Queue received burst for the reply handling in the main loop
+    if(!spsc_push(&rx_queue, data, length))
+    {
+        link_stats.rx_dropped += length;
+    }
+    else
+    {
+        // IDLE is detected one character time after the last byte
+        spsc_stamp(&rx_stamps, &rx_queue, perf_cycles());
+    }
+
+    // Debug output via UART1
+    DEBUG_PRINTF(UART_DEBUG, "[%.*s]", length, (char*)data);
+    if(data[length - 1] == '#')
+    {
+        DEBUG_PRINTF(UART_DEBUG, "\r\n");
+    }
+}
+
+/**
+ * @brief (Re)start circular DMA reception with IDLE line detection
+ */
+static void mount_link_start_rx(void)
+{
+    rx_read_pos = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(UART_OUT, rx_dma_buffer, MOUNT_LINK_RX_DMA_SIZE);
+}
+
+/**
+ * @brief Start a DMA transfer of the next contiguous block of the transmit queue
+ * @note  must be called with interrupts disabled
+ */
+static void mount_link_start_tx(void)
+{
+    if(tx_in_flight != 0)
+    {
+        return;
+    }
+
+    uint32_t pending = tx_head - tx_tail;
+    if(pending == 0)
+    {
+        return;
+    }
+
+    uint32_t start = tx_tail & (MOUNT_LINK_TX_QUEUE_SIZE - 1);
+    uint32_t length = MOUNT_LINK_TX_QUEUE_SIZE - start;
+    if(length > pending)
+    {
+        length = pending;
+    }
+
+    tx_in_flight = length;
+    if(HAL_UART_Transmit_DMA(UART_OUT, &tx_queue[start], length) != HAL_OK)
+    {
+        // UART busy, retried on the next send or completion
+        tx_in_flight = 0;
+    }
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void mount_link_init(void)
+{
+    mount_link_start_rx();
+}
+
+/**
+ * @brief Reception event from HAL (IDLE line, half or full buffer)
+ * @param dma_pos: current write position of the DMA inside the buffer
+ * @note  called in interrupt context, hands off everything since the last event
+ */
+void mount_link_rx_event(uint16_t dma_pos)
+{
+    if(dma_pos == rx_read_pos)
+    {
+        return;
+    }
+
+    link_stats.rx_bursts++;
+
+    if(dma_pos > rx_read_pos)
+    {
+        mount_link_handoff(&rx_dma_buffer[rx_read_pos], dma_pos - rx_read_pos);
+    }
+    else
+    {
+        // DMA wrapped around: tail of the buffer first, then the beginning
+        mount_link_handoff(&rx_dma_buffer[rx_read_pos], MOUNT_LINK_RX_DMA_SIZE - rx_read_pos);
+        if(dma_pos > 0)
+        {
+            mount_link_handoff(&rx_dma_buffer[0], dma_pos);
+        }
+    }
+
+    rx_read_pos = (dma_pos == MOUNT_LINK_RX_DMA_SIZE) ? 0 : dma_pos;
+}
+
+/**
+ * @brief UART error handling, any error aborts DMA reception in HAL
+ * @note  called in interrupt context
+ */
+void mount_link_error(void)
+{
+    uint32_t error = HAL_UART_GetError(UART_OUT);
+
+    if(error & HAL_UART_ERROR_ORE)
+    {
+        link_stats.overruns++;
+    }
+    if(error & (HAL_UART_ERROR_FE | HAL_UART_ERROR_NE | HAL_UART_ERROR_PE))
+    {
+        link_stats.framing_errors++;
+    }
+
+    link_stats.rx_restarts++;
+    mount_link_start_rx();
+}
+
+/**
+ * @brief Take received mount data out of the reception queue (main loop)
+ * @param cycles: cycle counter when the data was handed off, one burst per call
+ * @retval number of bytes copied
+ */
+uint16_t mount_link_read(uint8_t* data, uint16_t max_length, uint32_t* cycles)
+{
+    return spsc_pop(&rx_queue, data, spsc_stamp_limit(&rx_stamps, &rx_queue, max_length, cycles));
+}
+
+/**
+ * @brief Queue data for the mount, returns immediately
+ * @param data: bytes to send
+ * @param length: number of bytes
+ * @retval 1 if queued, 0 if the queue is full (nothing queued)
+ */
+uint8_t mount_link_send(const uint8_t* data, uint16_t length)
+{
+    uint8_t result = 1;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t used = tx_head - tx_tail;
+    if((MOUNT_LINK_TX_QUEUE_SIZE - used) < length)
+    {
+        link_stats.tx_dropped += length;
+        result = 0;
+    }
+    else
+    {
+        for(uint16_t i = 0; i < length; i++)
+        {
+            tx_queue[(tx_head + i) & (MOUNT_LINK_TX_QUEUE_SIZE - 1)] = data[i];
+        }
+        tx_head += length;
+
+        if((used + length) > link_stats.tx_high_water)
+        {
+            link_stats.tx_high_water = used + length;
+        }
+
+        mount_link_start_tx();
+    }
+
+    __set_PRIMASK(primask);
+    return result;
+}
+
+uint8_t mount_link_send_str(const char* str)
+{
+    return mount_link_send((const uint8_t*)str, strlen(str));
+}
+
+/**
+ * @brief DMA transfer finished and the last byte left the UART
+ * @note  called in interrupt context
+ */
+void mount_link_tx_complete(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    link_stats.tx_bytes += tx_in_flight;
+    tx_tail += tx_in_flight;
+
+    if((tx_done_head - tx_done_tail) < MOUNT_LINK_STAMPS)
+    {
+        tx_done_storage[tx_done_head & (MOUNT_LINK_STAMPS - 1)].end = tx_tail;
+        tx_done_storage[tx_done_head & (MOUNT_LINK_STAMPS - 1)].cycles = perf_cycles();
+        __DMB(); // entry must be visible before the new head
+        tx_done_head++;
+    }
+    tx_in_flight = 0;
+    mount_link_start_tx();
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Number of bytes waiting to be sent, including the running transfer
+ */
+uint16_t mount_link_tx_depth(void)
+{
+    return tx_head - tx_tail;
+}
+
+/**
+ * @brief Total number of bytes queued since start, position of the last queued byte
+ */
+uint32_t mount_link_tx_queued(void)
+{
+    return tx_head;
+}
+
+/**
+ * @brief Take the next completed transfer (main loop)
+ * @param end: mount_link_tx_queued() position after the last byte of the transfer
+ * @param cycles: cycle counter when this byte left the UART
+ * @retval 1 if a transfer was returned
+ * @note  a transfer is continuous, earlier bytes left one byte time apart
+ */
+uint8_t mount_link_tx_done(uint32_t* end, uint32_t* cycles)
+{
+    if(tx_done_tail == tx_done_head)
+    {
+        return 0;
+    }
+
+    __DMB();
+    *end = tx_done_storage[tx_done_tail & (MOUNT_LINK_STAMPS - 1)].end;
+    *cycles = tx_done_storage[tx_done_tail & (MOUNT_LINK_STAMPS - 1)].cycles;
+    __DMB();
+    tx_done_tail++;
+    return 1;
+}
+
+/**
+ * @brief Duration of one byte on the link in cycles (8N1)
+ */
+uint32_t mount_link_byte_cycles(void)
+{
+    return SystemCoreClock / ((UART_OUT)->Init.BaudRate / 10);
+}
+
+const mount_link_stats_t* mount_link_get_stats(void)
+{
+    return &link_stats;
+}
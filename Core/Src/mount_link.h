@@ -0,0 +1,63 @@
+/*
+ ******************************************************************************
+ * @file    mount_link.h
+ * @brief   Header for UART2 link to the telescope mount (DMA based)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef MOUNT_LINK_H
+#define MOUNT_LINK_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+#include "main.h"
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* size of the circular DMA receive buffer, ~130ms of data at 9600 baud */
+#define MOUNT_LINK_RX_DMA_SIZE      128
+/* size of the transmit queue, must be a power of two */
+#define MOUNT_LINK_TX_QUEUE_SIZE    256
+/* size of the queue between reception interrupt and main loop, must be a power of two */
+#define MOUNT_LINK_RX_QUEUE_SIZE    256
+/* reception stamps and completed transfers kept for the main loop, must be a power of two */
+#define MOUNT_LINK_STAMPS           16
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef struct {
+    uint32_t rx_bytes;          // bytes received from the mount
+    uint32_t rx_bursts;         // bursts handed off (IDLE, half or full buffer event)
+    uint32_t overruns;          // UART overrun errors (ORE)
+    uint32_t framing_errors;    // UART framing / noise / parity errors
+    uint32_t rx_restarts;       // DMA reception restarted after an error
+    uint32_t rx_dropped;        // bytes lost because the main loop did not keep up
+    uint32_t tx_bytes;          // bytes sent to the mount
+    uint32_t tx_dropped;        // bytes rejected because the transmit queue was full
+    uint32_t tx_high_water;     // maximum transmit queue depth seen
+} mount_link_stats_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void mount_link_init(void);
+void mount_link_rx_event(uint16_t dma_pos);
+void mount_link_error(void);
+uint16_t mount_link_read(uint8_t* data, uint16_t max_length, uint32_t* cycles);
+uint8_t mount_link_send(const uint8_t* data, uint16_t length);
+uint8_t mount_link_send_str(const char* str);
+void mount_link_tx_complete(void);
+uint16_t mount_link_tx_depth(void);
+uint32_t mount_link_tx_queued(void);
+uint8_t mount_link_tx_done(uint32_t* end, uint32_t* cycles);
+uint32_t mount_link_byte_cycles(void);
+const mount_link_stats_t* mount_link_get_stats(void);
+
+#endif // MOUNT_LINK_H
@@ -0,0 +1,355 @@
+/*
+ ******************************************************************************
+ * @file    mount_poller.c
+ * @brief   Background polling of the mount state
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * :GR#, :GD# and :D# are sent round robin as commands of the proxy itself,
+ * the replies refresh the position cache and the slewing state. A poll is
+ * only sent when no client command is in flight and the link was quiet for
+ * MOUNT_POLL_QUIET_MS, so the client never waits behind more than one poll.
+ *
+ * The link share is limited by a token bucket filled with the configured
+ * percentage of the link bytes per second.
+ *
+ * :D# is not known by every mount. A mount ignoring it would pass the reply
+ * of the next client command to the pending :D# poll, so :D# is probed as
+ * the first poll after mount_poller_init() and only polled further if the
+ * mount answered it. A reply without the form of the distance bar counts
+ * like a timeout.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <string.h>
+#include "main.h"
+#include "mount_link.h"
+#include "mount_reply.h"
+#include "mount_cache.h"
+#include "mount_poller.h"
+#include "event_loop.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+/* tokens are counted in 1/1000 byte */
+#define BUCKET_MAX              (64 * 1000)
+/* :D# is not polled anymore after this number of timeouts in a row */
+#define DISTANCE_MAX_TIMEOUTS   3
+/* first item after mount_poller_init(), probes :D# */
+#define DISTANCE_ITEM           0
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    const char* command;
+    mount_reply_cb_t callback;
+    uint8_t reply_len;          // expected reply length for the budget
+} poll_item_t;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTION PROTOTYPES
+ * ============================================================================ */
+static void poll_ra(const char* reply, uint32_t tag);
+static void poll_dec(const char* reply, uint32_t tag);
+static void poll_distance(const char* reply, uint32_t tag);
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static const poll_item_t poll_items[] = {
+    { ":D#",  poll_distance, 2  },
+    { ":GR#", poll_ra,       9  },
+    { ":GD#", poll_dec,      10 },
+};
+#define POLL_ITEMS  (sizeof(poll_items) / sizeof(poll_items[0]))
+
+static mount_poller_stats_t poller_stats = { .budget_pct = MOUNT_POLL_BUDGET_PCT };
+
+static uint8_t next_item = 0;
+static uint32_t next_tick = 0;
+static uint8_t poll_pending = 0;
+static uint8_t budget_waiting = 0;
+static uint32_t tokens = BUCKET_MAX;
+static uint32_t refill_tick = 0;
+static uint32_t moved_tick = 0;
+static uint8_t moved = 0;
+static uint8_t distance_timeouts = 0;
+static uint8_t distance_answered = 0;
+
+static uint32_t report_tick = 0;
+static uint32_t report_bytes = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint32_t link_bytes_per_s(void)
+{
+    return (UART_OUT)->Init.BaudRate / 10;   // 8N1
+}
+
+static void poll_done(const char* reply)
+{
+    poll_pending = 0;
+
+    if(reply == NULL)
+    {
+        poller_stats.timeouts++;
+        return;
+    }
+    poller_stats.bytes += strlen(reply);
+    report_bytes += strlen(reply);
+}
+
+static void poll_ra(const char* reply, uint32_t tag)
+{
+    poll_done(reply);
+    mount_cache_update_ra(reply, tag);
+}
+
+static void poll_dec(const char* reply, uint32_t tag)
+{
+    poll_done(reply);
+    mount_cache_update_dec(reply, tag);
+}
+
+/**
+ * @brief Reply has the form of the distance bar: bar characters and '#',
+ *        the reply of a client command (position, text) has letters or digits
+ */
+static uint8_t poll_distance_valid(const char* reply)
+{
+    size_t length = strlen(reply);
+
+    if((length == 0) || (reply[length - 1] != '#'))
+    {
+        return 0;
+    }
+    for(size_t i = 0; i < length - 1; i++)
+    {
+        char c = reply[i];
+
+        if(((c >= '0') && (c <= '9')) || ((c >= 'A') && (c <= 'Z')) || ((c >= 'a') && (c <= 'z')) || (c == ':'))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Distance bar, "#" when the mount does not slew
+ */
+static void poll_distance(const char* reply, uint32_t tag)
+{
+    poll_done(reply);
+
+    if((reply == NULL) || !poll_distance_valid(reply))
+    {
+        // never answered (probe): the mount does not know :D#
+        if(!distance_answered)
+        {
+            distance_timeouts = DISTANCE_MAX_TIMEOUTS;
+        }
+        else if(distance_timeouts < DISTANCE_MAX_TIMEOUTS)
+        {
+            distance_timeouts++;
+        }
+        if(reply != NULL)
+        {
+            UART_Printf(UART_DEBUG, "!! :D# reply %s not a distance bar\r\n", reply);
+        }
+        return;
+    }
+    distance_answered = 1;
+    distance_timeouts = 0;
+    poller_stats.slewing = (reply[0] != '#');
+}
+
+/**
+ * @brief Item polled next, :D# is passed over once the mount gave no reply to it
+ */
+static uint8_t poller_item_index(void)
+{
+    if((poll_items[next_item].callback == poll_distance) && (distance_timeouts >= DISTANCE_MAX_TIMEOUTS))
+    {
+        return (next_item + 1) % POLL_ITEMS;
+    }
+    return next_item;
+}
+
+/**
+ * @brief Fill the token bucket and report the utilization
+ */
+static void poller_account(uint32_t now)
+{
+    uint32_t elapsed = now - refill_tick;
+
+    refill_tick = now;
+    if(elapsed > 1000)
+    {
+        elapsed = 1000; // bucket is full anyway, avoids overflow
+    }
+    // ms * bytes/s = 1/1000 bytes
+    tokens += elapsed * link_bytes_per_s() * poller_stats.budget_pct / 100;
+    if(tokens > BUCKET_MAX)
+    {
+        tokens = BUCKET_MAX;
+    }
+
+    if((now - report_tick) >= MOUNT_POLL_REPORT_MS)
+    {
+        uint32_t link_bytes = link_bytes_per_s() * (MOUNT_POLL_REPORT_MS / 1000);
+
+        poller_stats.utilization = (uint16_t)(report_bytes * 1000 / link_bytes);
+        report_bytes = 0;
+        report_tick = now;
+
+        UART_Printf(UART_DEBUG, "Poller: link %u.%u%% (budget %u%%), %lu polls, %lu timeouts\r\n",
+                    poller_stats.utilization / 10, poller_stats.utilization % 10, poller_stats.budget_pct,
+                    (unsigned long)poller_stats.polls, (unsigned long)poller_stats.timeouts);
+    }
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Start polling with the :D# probe (after a reset of the mount link)
+ */
+void mount_poller_init(void)
+{
+    next_item = DISTANCE_ITEM;
+    next_tick = HAL_GetTick();
+    poll_pending = 0;
+    distance_timeouts = 0;
+    distance_answered = 0;
+    poller_stats.slewing = 0;
+}
+
+/**
+ * @brief Send the next poll if it is due and the link is idle (main loop)
+ */
+void mount_poller_process(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    poller_account(now);
+
+    if(poller_item_index() != next_item)
+    {
+        // mount does not know :D#, slewing is only assumed after movement commands
+        poller_stats.slewing = 0;
+        next_item = poller_item_index();
+    }
+    if(poll_pending || ((int32_t)(now - next_tick) < 0))
+    {
+        return;
+    }
+    if((mount_reply_pending() > 0) || (mount_link_tx_depth() > 0) || (mount_reply_idle_ms() < MOUNT_POLL_QUIET_MS))
+    {
+        return;
+    }
+
+    const poll_item_t* item = &poll_items[next_item];
+    uint32_t length = strlen(item->command);
+    uint32_t cost = (length + item->reply_len) * 1000;
+
+    if(tokens < cost)
+    {
+        if(!budget_waiting)
+        {
+            poller_stats.budget_waits++;
+            budget_waiting = 1;
+        }
+        return;
+    }
+
+    if(!mount_request(item->command, MOUNT_REPLY_HASH, MOUNT_OWNER_PROXY, item->callback, mount_cache_generation()))
+    {
+        return;
+    }
+    tokens -= cost;
+    budget_waiting = 0;
+    poll_pending = 1;
+    poller_stats.polls++;
+    poller_stats.bytes += length;
+    report_bytes += length;
+
+    if(moved && ((now - moved_tick) >= MOUNT_POLL_MOVE_MS))
+    {
+        moved = 0;
+    }
+    uint32_t round_ms = (poller_stats.slewing || moved) ? MOUNT_POLL_FAST_MS : MOUNT_POLL_SLOW_MS;
+
+    next_item = (next_item + 1) % POLL_ITEMS;
+    next_tick = now + round_ms / POLL_ITEMS;
+}
+
+/**
+ * @brief Time until the next poll can be sent, the end of a command in flight
+ *        is covered by mount_reply_next_ms()
+ * @retval ms, EVENT_NO_DEADLINE if only the utilization report is pending
+ */
+uint32_t mount_poller_next_ms(void)
+{
+    uint32_t now = HAL_GetTick();
+    uint32_t report_ms = event_ms_until(report_tick + MOUNT_POLL_REPORT_MS, now);
+
+    if(poll_pending || (mount_reply_pending() > 0) || (mount_link_tx_depth() > 0))
+    {
+        return report_ms;
+    }
+
+    const poll_item_t* item = &poll_items[poller_item_index()];
+    uint32_t next = event_ms_until(next_tick, now);
+    uint32_t idle_ms = mount_reply_idle_ms();
+
+    if((idle_ms < MOUNT_POLL_QUIET_MS) && ((MOUNT_POLL_QUIET_MS - idle_ms) > next))
+    {
+        next = MOUNT_POLL_QUIET_MS - idle_ms;
+    }
+
+    uint32_t cost = (strlen(item->command) + item->reply_len) * 1000;
+
+    if(tokens < cost)
+    {
+        uint32_t rate = link_bytes_per_s() * poller_stats.budget_pct / 100;   // per ms
+        uint32_t refill_ms = (rate > 0) ? (cost - tokens + rate - 1) / rate : EVENT_NO_DEADLINE;
+
+        if(refill_ms > next)
+        {
+            next = refill_ms;
+        }
+    }
+    return (next < report_ms) ? next : report_ms;
+}
+
+/**
+ * @brief A movement command was sent, poll fast and start now
+ */
+void mount_poller_moved(void)
+{
+    moved = 1;
+    moved_tick = HAL_GetTick();
+    next_tick = moved_tick;
+}
+
+/**
+ * @brief Link share of the poller in percent
+ */
+void mount_poller_set_budget(uint8_t percent)
+{
+    poller_stats.budget_pct = (percent > 100) ? 100 : percent;
+}
+
+const mount_poller_stats_t* mount_poller_get_stats(void)
+{
+    return &poller_stats;
+}
@@ -0,0 +1,63 @@
+/*
+ ******************************************************************************
+ * @file    mount_poller.h
+ * @brief   Header for the background polling of the mount state
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef MOUNT_POLLER_H
+#define MOUNT_POLLER_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* time for one round of :D#, :GR# and :GD# */
+#ifndef MOUNT_POLL_SLOW_MS
+#define MOUNT_POLL_SLOW_MS      750     // tracking, must be below MOUNT_CACHE_MAX_AGE_MS
+#endif
+#ifndef MOUNT_POLL_FAST_MS
+#define MOUNT_POLL_FAST_MS      300     // slewing
+#endif
+/* share of the link the poller may use in percent */
+#ifndef MOUNT_POLL_BUDGET_PCT
+#define MOUNT_POLL_BUDGET_PCT   15
+#endif
+/* silence on the link before a poll is sent, keeps the gaps for the client */
+#define MOUNT_POLL_QUIET_MS     20
+/* fast polling after a movement command, until :D# reports the end of the slew */
+#define MOUNT_POLL_MOVE_MS      3000
+/* interval of the utilization report on the debug UART */
+#define MOUNT_POLL_REPORT_MS    60000
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef struct {
+    uint32_t polls;             // poll commands sent
+    uint32_t timeouts;          // poll replies not received
+    uint32_t budget_waits;      // polls delayed by the link budget
+    uint32_t bytes;             // link bytes used by the poller, both directions
+    uint16_t utilization;       // link utilization of the last report interval in 0.1%
+    uint8_t budget_pct;         // configured budget
+    uint8_t slewing;            // mount reports a slew (:D#)
+} mount_poller_stats_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void mount_poller_init(void);
+void mount_poller_process(void);
+uint32_t mount_poller_next_ms(void);
+void mount_poller_moved(void);
+void mount_poller_set_budget(uint8_t percent);
+const mount_poller_stats_t* mount_poller_get_stats(void);
+
+#endif // MOUNT_POLLER_H
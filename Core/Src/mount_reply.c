@@ -0,0 +1,518 @@
+/*
+ ******************************************************************************
+ * @file    mount_reply.c
+ * @brief   Matching mount replies to the commands sent to the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * The LX200 protocol has no request ids, the mount answers in the order the
+ * commands were sent. Every command with a reply is kept in a FIFO together
+ * with the expected reply form, the received bytes are framed accordingly:
+ *   - replies to client commands are passed to USB and to the callback
+ *   - replies to commands of the proxy itself (e.g. polling) are consumed
+ *   - bytes without a pending command are passed to USB unchanged
+ *
+ * Answers of the proxy itself (cache hits, suppressed commands, local
+ * commands) go through mount_reply_local(): while replies to earlier client
+ * commands are pending, the answer waits behind them and is passed to USB
+ * when the last of them is complete, so the client gets the replies in the
+ * order of its commands. An answer is passed to USB in one piece (at most
+ * MOUNT_REPLY_LOCAL_MAX_LEN characters), an answer that does not fit into a
+ * full local queue is dropped rather than sent ahead of the client replies.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <string.h>
+#include "main.h"
+#include "usbd_cdc_if.h"
+#include "mount_link.h"
+#include "mount_reply.h"
+#include "perf_counter.h"
+#include "lx200_latency.h"
+#include "mount_rtt.h"
+#include "event_loop.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define CLIENT_BUFFER_SIZE  64
+/* commands on their way to the mount, must be a power of two */
+#define TX_MARKS            (2 * MOUNT_REPLY_PENDING)
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    mount_reply_kind_t kind;
+    mount_owner_t owner;
+    mount_reply_cb_t callback;
+    uint32_t tag;
+    uint32_t start_tick;    // became oldest pending command / last byte received
+    lx200_timing_t timing;  // client command timestamps
+    uint32_t seq;
+    uint32_t tx_left;       // cycles when the last command byte left the UART
+    uint8_t sent;           // tx_left is valid
+    char type[3];           // command start for the round trip statistics
+} mount_pending_t;
+
+/* local answer, passed to USB after the client command after_seq */
+typedef struct {
+    uint32_t after_seq;
+    uint16_t length;
+    lx200_timing_t timing;
+} mount_local_t;
+
+/* command on its way to the mount */
+typedef struct {
+    uint32_t tx_end;        // mount_link_tx_queued() after the command
+    uint32_t seq;           // pending entry, 0 for commands without reply
+    lx200_timing_t timing;
+} mount_tx_mark_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static mount_pending_t pending[MOUNT_REPLY_PENDING];
+static uint8_t pending_head = 0;
+static uint8_t pending_count = 0;
+
+/* reply of the oldest pending command */
+static char reply[MOUNT_REPLY_MAX_LEN];
+static uint8_t reply_len = 0;
+
+/* bytes for the client, sent in one block */
+static uint8_t client_buffer[CLIENT_BUFFER_SIZE];
+static uint16_t client_len = 0;
+
+static mount_reply_stats_t reply_stats;
+
+/* commands not completely sent yet */
+static mount_tx_mark_t tx_marks[TX_MARKS];
+static uint8_t tx_marks_head = 0;
+static uint8_t tx_marks_count = 0;
+static uint32_t request_seq = 0;
+
+/* local answers waiting, their text in a ring */
+static mount_local_t locals[MOUNT_REPLY_LOCAL];
+static uint8_t locals_head = 0;
+static uint8_t locals_count = 0;
+static char local_text[MOUNT_REPLY_LOCAL_SIZE];
+static uint16_t local_text_head = 0;
+static uint16_t local_text_used = 0;
+
+/* reception time of the bytes currently framed */
+static uint32_t rx_cycles = 0;
+
+/* last request sent or byte received */
+static uint32_t last_activity_tick = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static void mount_reply_flush_client(void)
+{
+    if(client_len > 0)
+    {
+        CDC_Transmit_FS(client_buffer, client_len);
+        client_len = 0;
+    }
+}
+
+static void mount_reply_to_client(uint8_t c)
+{
+    if(client_len >= CLIENT_BUFFER_SIZE)
+    {
+        mount_reply_flush_client();
+    }
+    client_buffer[client_len++] = c;
+}
+
+/**
+ * @brief Sequence number of the oldest (newest) pending client command
+ * @retval 0 if no client reply is pending
+ */
+static uint32_t mount_reply_client_seq(uint8_t newest)
+{
+    uint32_t seq = 0;
+
+    for(uint8_t i = 0; i < pending_count; i++)
+    {
+        const mount_pending_t* p = &pending[(pending_head + i) & (MOUNT_REPLY_PENDING - 1)];
+
+        if(p->owner == MOUNT_OWNER_CLIENT)
+        {
+            seq = p->seq;
+            if(!newest)
+            {
+                break;
+            }
+        }
+    }
+    return seq;
+}
+
+/**
+ * @brief Pass the local answers to the client whose preceding client replies are complete
+ */
+static void mount_reply_release_local(void)
+{
+    uint32_t oldest = mount_reply_client_seq(0);
+
+    mount_reply_flush_client();
+
+    /* int32_t cast handles the wrap of the sequence numbers */
+    while((locals_count > 0) && ((oldest == 0) || ((int32_t)(oldest - locals[locals_head].after_seq) > 0)))
+    {
+        mount_local_t* local = &locals[locals_head];
+        uint16_t first = MOUNT_REPLY_LOCAL_SIZE - local_text_head;
+
+        // the text may wrap at the end of the ring
+        if(first >= local->length)
+        {
+            CDC_Transmit_FS((uint8_t*)&local_text[local_text_head], local->length);
+        }
+        else
+        {
+            CDC_Transmit_FS((uint8_t*)&local_text[local_text_head], first);
+            CDC_Transmit_FS((uint8_t*)local_text, local->length - first);
+        }
+        local_text_head = (local_text_head + local->length) % MOUNT_REPLY_LOCAL_SIZE;
+        lx200_latency_record(&local->timing, LX200_STAGE_RESPONSE, perf_cycles());
+
+        local_text_used -= local->length;
+        locals_head = (locals_head + 1) & (MOUNT_REPLY_LOCAL - 1);
+        locals_count--;
+    }
+}
+
+/**
+ * @brief Remove the oldest pending command and report its reply
+ * @param text: complete reply, NULL on timeout
+ */
+static void mount_reply_finish(const char* text)
+{
+    mount_pending_t done = pending[pending_head];
+
+    pending_head = (pending_head + 1) & (MOUNT_REPLY_PENDING - 1);
+    pending_count--;
+    reply_len = 0;
+
+    // the timeout of the next command starts now
+    if(pending_count > 0)
+    {
+        pending[pending_head].start_tick = HAL_GetTick();
+    }
+
+    if(done.sent && (text != NULL) && (done.kind != MOUNT_REPLY_UNKNOWN))
+    {
+        mount_rtt_record(done.type, rx_cycles - done.tx_left);
+    }
+
+    if((done.owner == MOUNT_OWNER_CLIENT) && (text != NULL))
+    {
+        mount_reply_flush_client();
+        lx200_latency_record(&done.timing, LX200_STAGE_RESPONSE, perf_cycles());
+    }
+    if(done.owner == MOUNT_OWNER_CLIENT)
+    {
+        // also on timeout, the client gets no reply for that command
+        mount_reply_release_local();
+    }
+
+    if(done.callback != NULL)
+    {
+        // bytes before this reply must reach the client before any answer of the callback
+        mount_reply_flush_client();
+        done.callback(text, done.tag);
+    }
+}
+
+/**
+ * @brief Frame one received byte
+ */
+static void mount_reply_byte(uint8_t c)
+{
+    last_activity_tick = HAL_GetTick();
+
+    if(pending_count == 0)
+    {
+        reply_stats.unsolicited++;
+        mount_reply_to_client(c);
+        return;
+    }
+
+    mount_pending_t* p = &pending[pending_head];
+    uint8_t complete;
+
+    if(p->owner == MOUNT_OWNER_CLIENT)
+    {
+        mount_reply_to_client(c);
+    }
+    if(reply_len < (MOUNT_REPLY_MAX_LEN - 1))
+    {
+        reply[reply_len++] = (char)c;
+    }
+    p->start_tick = last_activity_tick;
+
+    switch(p->kind)
+    {
+        case MOUNT_REPLY_CHAR:
+            complete = 1;
+            break;
+        case MOUNT_REPLY_GOTO:
+            complete = ((reply_len == 1) && (c == '0')) || (c == '#');
+            break;
+        default:
+            complete = (c == '#');
+            break;
+    }
+
+    if(complete)
+    {
+        reply[reply_len] = '\0';
+        reply_stats.replies++;
+        mount_reply_finish(reply);
+    }
+}
+
+/**
+ * @brief Timestamp the commands that left the UART
+ */
+static void mount_reply_check_sent(void)
+{
+    uint32_t end;
+    uint32_t done_cycles;
+
+    while(mount_link_tx_done(&end, &done_cycles))
+    {
+        while((tx_marks_count > 0) && ((int32_t)(end - tx_marks[tx_marks_head].tx_end) >= 0))
+        {
+            mount_tx_mark_t* mark = &tx_marks[tx_marks_head];
+
+            // the transfer continued with later commands after this one
+            uint32_t left = done_cycles - (end - mark->tx_end) * mount_link_byte_cycles();
+            lx200_latency_record(&mark->timing, LX200_STAGE_FORWARD, left);
+
+            for(uint8_t i = 0; (mark->seq != 0) && (i < pending_count); i++)
+            {
+                mount_pending_t* p = &pending[(pending_head + i) & (MOUNT_REPLY_PENDING - 1)];
+
+                if(p->seq == mark->seq)
+                {
+                    p->tx_left = left;
+                    p->sent = 1;
+                    break;
+                }
+            }
+
+            tx_marks_head = (tx_marks_head + 1) & (TX_MARKS - 1);
+            tx_marks_count--;
+        }
+    }
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Send a command to the mount and register its expected reply
+ * @param command: complete command string
+ * @param kind: form of the reply
+ * @param owner: receiver of the reply
+ * @param callback: optional, called with the reply in the main loop
+ * @param tag: passed to the callback
+ * @retval 1 if queued, 0 if the pending list or the transmit queue is full
+ */
+uint8_t mount_request(const char* command, mount_reply_kind_t kind, mount_owner_t owner,
+                      mount_reply_cb_t callback, uint32_t tag)
+{
+    if((kind != MOUNT_REPLY_NONE) && (pending_count >= MOUNT_REPLY_PENDING))
+    {
+        reply_stats.rejected++;
+        return 0;
+    }
+    if(!mount_link_send_str(command))
+    {
+        reply_stats.rejected++;
+        return 0;
+    }
+    reply_stats.requests++;
+    last_activity_tick = HAL_GetTick();
+
+    lx200_timing_t timing = lx200_latency_current();
+
+    if(owner != MOUNT_OWNER_CLIENT)
+    {
+        timing.valid = 0;
+    }
+    request_seq = (request_seq + 1) ? (request_seq + 1) : 1;
+
+    if(tx_marks_count < TX_MARKS)
+    {
+        mount_tx_mark_t* mark = &tx_marks[(tx_marks_head + tx_marks_count) & (TX_MARKS - 1)];
+
+        mark->tx_end = mount_link_tx_queued();
+        mark->seq = (kind != MOUNT_REPLY_NONE) ? request_seq : 0;
+        mark->timing = timing;
+        tx_marks_count++;
+    }
+
+    if(kind != MOUNT_REPLY_NONE)
+    {
+        mount_pending_t* p = &pending[(pending_head + pending_count) & (MOUNT_REPLY_PENDING - 1)];
+
+        p->seq = request_seq;
+        p->sent = 0;
+        strncpy(p->type, command, sizeof(p->type));
+
+        p->kind = kind;
+        p->owner = owner;
+        p->callback = callback;
+        p->tag = tag;
+        p->start_tick = HAL_GetTick();
+        p->timing = timing;
+        if(kind == MOUNT_REPLY_UNKNOWN)
+        {
+            p->timing.valid = 0;    // end of the reply is only guessed
+        }
+        pending_count++;
+    }
+    return 1;
+}
+
+/**
+ * @brief Frame received mount data and route complete replies (main loop)
+ */
+void mount_reply_process(void)
+{
+    uint8_t data[32];
+    uint16_t n;
+
+    // send time first, a fast reply may already be waiting
+    mount_reply_check_sent();
+
+    while((n = mount_link_read(data, sizeof(data), &rx_cycles)) > 0)
+    {
+        for(uint16_t i = 0; i < n; i++)
+        {
+            mount_reply_byte(data[i]);
+        }
+    }
+    mount_reply_flush_client();
+
+    if(pending_count > 0)
+    {
+        mount_pending_t* p = &pending[pending_head];
+        uint32_t age = HAL_GetTick() - p->start_tick;
+
+        if((p->kind == MOUNT_REPLY_UNKNOWN) && (age >= MOUNT_REPLY_QUIET_MS))
+        {
+            // whatever came is the reply, maybe nothing at all
+            reply[reply_len] = '\0';
+            if(reply_len > 0)
+            {
+                reply_stats.replies++;
+            }
+            mount_reply_finish(reply);
+        }
+        else if(age >= MOUNT_REPLY_TIMEOUT_MS)
+        {
+            reply_stats.timeouts++;
+            DEBUG_PRINTF(UART_DEBUG, "!! mount reply timeout\r\n");
+            mount_reply_finish(NULL);
+        }
+    }
+}
+
+/**
+ * @brief Time until the oldest pending reply is complete by silence or given up,
+ *        received bytes wake the main loop by EVENT_MOUNT_RX
+ * @retval ms, EVENT_NO_DEADLINE without pending commands
+ */
+uint32_t mount_reply_next_ms(void)
+{
+    if(pending_count == 0)
+    {
+        return EVENT_NO_DEADLINE;
+    }
+
+    const mount_pending_t* p = &pending[pending_head];
+    uint32_t limit = (p->kind == MOUNT_REPLY_UNKNOWN) ? MOUNT_REPLY_QUIET_MS : MOUNT_REPLY_TIMEOUT_MS;
+
+    return event_ms_until(p->start_tick + limit, HAL_GetTick());
+}
+
+/**
+ * @brief Number of commands waiting for their reply
+ */
+uint8_t mount_reply_pending(void)
+{
+    return pending_count;
+}
+
+/**
+ * @brief Answer of the proxy to a client command, sent now or after the replies
+ *        of the client commands still pending (see the file header)
+ * @note  the answer is dropped if the local queue is full, the order of the
+ *        replies is kept
+ */
+void mount_reply_local(const char* text)
+{
+    uint16_t length = (uint16_t)strlen(text);
+    uint32_t after = mount_reply_client_seq(1);
+
+    if(length == 0)
+    {
+        return;
+    }
+    if((after == 0) && (locals_count > 0))
+    {
+        // behind the answers still waiting
+        after = locals[(locals_head + locals_count - 1) & (MOUNT_REPLY_LOCAL - 1)].after_seq;
+    }
+    if(after == 0)
+    {
+        mount_reply_flush_client();
+        CDC_Transmit_FS((uint8_t*)text, length);
+        lx200_latency_responded();
+        return;
+    }
+    if((locals_count >= MOUNT_REPLY_LOCAL) || (length > MOUNT_REPLY_LOCAL_SIZE - local_text_used))
+    {
+        reply_stats.local_dropped++;
+        UART_Printf(UART_DEBUG, "!! local answer dropped, %u waiting\r\n", locals_count);
+        return;
+    }
+
+    mount_local_t* local = &locals[(locals_head + locals_count) & (MOUNT_REPLY_LOCAL - 1)];
+    uint16_t tail = (local_text_head + local_text_used) % MOUNT_REPLY_LOCAL_SIZE;
+
+    for(uint16_t n = 0; n < length; n++)
+    {
+        local_text[tail] = text[n];
+        tail = (tail + 1) % MOUNT_REPLY_LOCAL_SIZE;
+    }
+    local->after_seq = after;
+    local->length = length;
+    local->timing = lx200_latency_respond_later();
+    local_text_used += length;
+    locals_count++;
+}
+
+/**
+ * @brief Time since the last command was sent or the last byte was received
+ */
+uint32_t mount_reply_idle_ms(void)
+{
+    return HAL_GetTick() - last_activity_tick;
+}
+
+const mount_reply_stats_t* mount_reply_get_stats(void)
+{
+    return &reply_stats;
+}
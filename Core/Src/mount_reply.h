@@ -0,0 +1,78 @@
+/*
+ ******************************************************************************
+ * @file    mount_reply.h
+ * @brief   Header for matching mount replies to the commands sent to the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef MOUNT_REPLY_H
+#define MOUNT_REPLY_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* commands waiting for a reply, must be a power of two */
+#define MOUNT_REPLY_PENDING         8
+/* longest reply kept for the callback, longer replies are truncated */
+#define MOUNT_REPLY_MAX_LEN         32
+/* a reply not complete after this time is given up */
+#define MOUNT_REPLY_TIMEOUT_MS      1000
+/* unknown commands: reply is complete after this silence */
+#define MOUNT_REPLY_QUIET_MS        100
+/* local answers waiting behind client replies, must be a power of two */
+#define MOUNT_REPLY_LOCAL           8
+/* longest local answer (:XH# :XR# :XT#), one write well below the 1024 byte CDC TX ring */
+#define MOUNT_REPLY_LOCAL_MAX_LEN   800
+/* characters of all waiting local answers */
+#define MOUNT_REPLY_LOCAL_SIZE      (2 * MOUNT_REPLY_LOCAL_MAX_LEN)
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef enum {
+    MOUNT_REPLY_NONE = 0,       // command has no reply
+    MOUNT_REPLY_HASH,           // reply terminated by '#', e.g. :GR#
+    MOUNT_REPLY_CHAR,           // single character, e.g. '1' of :Sr
+    MOUNT_REPLY_GOTO,           // :MS#, '0' or '1' / '2' followed by a message and '#'
+    MOUNT_REPLY_UNKNOWN         // not known, complete at '#' or after MOUNT_REPLY_QUIET_MS
+} mount_reply_kind_t;
+
+typedef enum {
+    MOUNT_OWNER_CLIENT = 0,     // reply is passed to the USB client
+    MOUNT_OWNER_PROXY           // reply is consumed by the proxy
+} mount_owner_t;
+
+/* called in the main loop with the complete reply (NUL terminated, truncated
+ * to MOUNT_REPLY_MAX_LEN - 1 characters), reply is NULL on timeout */
+typedef void (*mount_reply_cb_t)(const char* reply, uint32_t tag);
+
+typedef struct {
+    uint32_t requests;          // commands sent via mount_request()
+    uint32_t replies;           // replies matched to a command
+    uint32_t timeouts;          // replies given up
+    uint32_t unsolicited;       // bytes received without a pending command
+    uint32_t rejected;          // requests rejected, pending list or transmit queue full
+    uint32_t local_dropped;     // local answers dropped, local queue full
+} mount_reply_stats_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+uint8_t mount_request(const char* command, mount_reply_kind_t kind, mount_owner_t owner,
+                      mount_reply_cb_t callback, uint32_t tag);
+void mount_reply_process(void);
+uint32_t mount_reply_next_ms(void);
+uint8_t mount_reply_pending(void);
+void mount_reply_local(const char* text);
+uint32_t mount_reply_idle_ms(void);
+const mount_reply_stats_t* mount_reply_get_stats(void);
+
+#endif // MOUNT_REPLY_H
@@ -0,0 +1,276 @@
+/*
+ ******************************************************************************
+ * @file    mount_rtt.c
+ * @brief   Round trip time statistics of the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * The round trip of a command is measured from its last byte leaving USART2
+ * to the reception of the complete reply, so it holds only the time of the
+ * mount firmware and of the reply on the wire (+ one character time for the
+ * IDLE detection). Statistics are kept per command type (2 characters after
+ * the ':'), percentiles come from a histogram with 4 buckets per octave.
+ *
+ * :XR# reply, all values in us:
+ *   "<type>:<count>,<min>,<mean>,<p50>,<p90>,<p99>,<max>;" ... "#"
+ * ("+#" at the end if types were left out, answer too long)
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+#include "perf_counter.h"
+#include "mount_rtt.h"
+#include "scheduler.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define RTT_BUCKET_US   16
+/* the summary is printed one line per run, this far apart */
+#define RTT_LINE_MS     50
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    char name[3];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint16_t buckets[MOUNT_RTT_BUCKETS];
+} rtt_type_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static rtt_type_t rtt_types[MOUNT_RTT_TYPES];
+static uint8_t report_pending = 0;
+/* next type of the summary on the debug UART, MOUNT_RTT_TYPES when idle */
+static uint8_t report_type = MOUNT_RTT_TYPES;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint8_t rtt_bucket(uint32_t us)
+{
+    uint32_t v = us / RTT_BUCKET_US;
+
+    if(v < 4)
+    {
+        return (uint8_t)v;
+    }
+
+    uint32_t e = 31 - __CLZ(v);
+    uint32_t index = 4 * (e - 1) + ((v >> (e - 2)) & 3);
+
+    return (index < MOUNT_RTT_BUCKETS) ? (uint8_t)index : (MOUNT_RTT_BUCKETS - 1);
+}
+
+/**
+ * @brief Lower limit of a bucket in us
+ */
+static uint32_t rtt_bucket_us(uint32_t index)
+{
+    if(index < 4)
+    {
+        return index * RTT_BUCKET_US;
+    }
+    return ((4 + (index & 3)) << (index / 4 - 1)) * RTT_BUCKET_US;
+}
+
+/**
+ * @brief Percentile, middle of the bucket it falls in (limited to min / max)
+ */
+static uint32_t rtt_percentile(const rtt_type_t* type, uint32_t percent)
+{
+    uint32_t total = 0;
+    uint32_t target;
+
+    for(uint8_t i = 0; i < MOUNT_RTT_BUCKETS; i++)
+    {
+        total += type->buckets[i];
+    }
+    target = (total * percent + 99) / 100;
+
+    uint32_t sum = 0;
+    for(uint8_t i = 0; i < MOUNT_RTT_BUCKETS - 1; i++)
+    {
+        sum += type->buckets[i];
+        if(sum >= target)
+        {
+            uint32_t value = (rtt_bucket_us(i) + rtt_bucket_us(i + 1)) / 2;
+
+            if(value < type->min_us)
+            {
+                return type->min_us;
+            }
+            return (value < type->max_us) ? value : type->max_us;
+        }
+    }
+    return type->max_us;
+}
+
+static rtt_type_t* rtt_find(const char* command)
+{
+    char c1 = command[1];
+    char c2 = (c1 != '\0') ? command[2] : '\0';
+
+    for(uint8_t i = 0; i < MOUNT_RTT_TYPES - 1; i++)
+    {
+        rtt_type_t* type = &rtt_types[i];
+
+        if(type->name[0] == '\0')
+        {
+            type->name[0] = c1;
+            type->name[1] = (c2 == '#') ? '\0' : c2;
+            return type;
+        }
+        if((type->name[0] == c1) && ((type->name[1] == c2) || ((type->name[1] == '\0') && (c2 == '#'))))
+        {
+            return type;
+        }
+    }
+
+    rtt_type_t* other = &rtt_types[MOUNT_RTT_TYPES - 1];
+    other->name[0] = '?';
+    other->name[1] = '?';
+    return other;
+}
+
+static void rtt_format(const rtt_type_t* type, char* out, uint16_t size)
+{
+    snprintf(out, size, "%s:%lu,%lu,%lu,%lu,%lu,%lu,%lu;", type->name, (unsigned long)type->count,
+             (unsigned long)type->min_us, (unsigned long)(type->sum_us / type->count),
+             (unsigned long)rtt_percentile(type, 50), (unsigned long)rtt_percentile(type, 90),
+             (unsigned long)rtt_percentile(type, 99), (unsigned long)type->max_us);
+}
+
+static void mount_rtt_report(void* context);
+
+/* one line of up to 60 characters on the 115200 baud debug UART */
+static const sched_task_t rtt_report_task = { "rtt", mount_rtt_report, MOUNT_RTT_REPORT_MS, 6000 };
+
+/**
+ * @brief Print the statistics on the debug UART, scheduler task every MOUNT_RTT_REPORT_MS
+ * @note  UART_Printf() blocks, the header and each type get a run of their own,
+ *        RTT_LINE_MS apart
+ */
+static void mount_rtt_report(void* context)
+{
+    char line[96];
+
+    if(report_type >= MOUNT_RTT_TYPES)
+    {
+        if(!report_pending)
+        {
+            return;
+        }
+        report_pending = 0;
+        report_type = 0;
+        UART_Printf(UART_DEBUG, "Mount RTT us (count,min,mean,p50,p90,p99,max):\r\n");
+        sched_start(&rtt_report_task, RTT_LINE_MS, NULL);
+        return;
+    }
+
+    while((report_type < MOUNT_RTT_TYPES) && (rtt_types[report_type].count == 0))
+    {
+        report_type++;
+    }
+    if(report_type < MOUNT_RTT_TYPES)
+    {
+        rtt_format(&rtt_types[report_type], line, sizeof(line));
+        UART_Printf(UART_DEBUG, "  %s\r\n", line);
+        report_type++;
+    }
+    while((report_type < MOUNT_RTT_TYPES) && (rtt_types[report_type].count == 0))
+    {
+        report_type++;
+    }
+    // the last line restores the period
+    sched_start(&rtt_report_task, (report_type < MOUNT_RTT_TYPES) ? RTT_LINE_MS : MOUNT_RTT_REPORT_MS, NULL);
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Start the periodic summary on the debug UART
+ */
+void mount_rtt_init(void)
+{
+    sched_start(&rtt_report_task, MOUNT_RTT_REPORT_MS, NULL);
+}
+
+/**
+ * @brief Count the round trip time of a command
+ * @param command: command string, only the type characters are used
+ * @param cycles: round trip in cycles
+ */
+void mount_rtt_record(const char* command, uint32_t cycles)
+{
+    rtt_type_t* type = rtt_find(command);
+    uint32_t us = PERF_CYCLES_TO_US(cycles);
+    uint8_t bucket = rtt_bucket(us);
+
+    if((type->count == 0) || (us < type->min_us))
+    {
+        type->min_us = us;
+    }
+    if(us > type->max_us)
+    {
+        type->max_us = us;
+    }
+    type->count++;
+    type->sum_us += us;
+
+    if(type->buckets[bucket] == UINT16_MAX)
+    {
+        // keep the distribution, halve all counts
+        for(uint8_t i = 0; i < MOUNT_RTT_BUCKETS; i++)
+        {
+            type->buckets[i] /= 2;
+        }
+    }
+    type->buckets[bucket]++;
+    report_pending = 1;
+}
+
+void mount_rtt_reset(void)
+{
+    memset(rtt_types, 0, sizeof(rtt_types));
+}
+
+/**
+ * @brief Statistics of all command types as one answer, see the file header for the format
+ */
+void mount_rtt_format(char* buffer, uint16_t size)
+{
+    char line[96];
+    uint16_t used = 0;
+    uint8_t full = 0;
+
+    for(uint8_t i = 0; (i < MOUNT_RTT_TYPES) && !full; i++)
+    {
+        if(rtt_types[i].count > 0)
+        {
+            rtt_format(&rtt_types[i], line, sizeof(line));
+            // room for "+#" and the terminator
+            if(used + strlen(line) + 3 > size)
+            {
+                full = 1;
+                break;
+            }
+            memcpy(&buffer[used], line, strlen(line));
+            used += strlen(line);
+        }
+    }
+    snprintf(&buffer[used], size - used, "%s", full ? "+#" : "#");
+}
@@ -0,0 +1,37 @@
+/*
+ ******************************************************************************
+ * @file    mount_rtt.h
+ * @brief   Header for the round trip time statistics of the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef MOUNT_RTT_H
+#define MOUNT_RTT_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* command types with own statistics, further types share the last entry "??" */
+#define MOUNT_RTT_TYPES         8
+/* histogram buckets for the percentiles, 4 per octave of 16us steps (up to ~1s) */
+#define MOUNT_RTT_BUCKETS       64
+/* interval of the summary on the debug UART */
+#define MOUNT_RTT_REPORT_MS     60000
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void mount_rtt_init(void);
+void mount_rtt_record(const char* command, uint32_t cycles);
+void mount_rtt_reset(void);
+void mount_rtt_format(char* buffer, uint16_t size);
+
+#endif // MOUNT_RTT_H
@@ -0,0 +1,149 @@
+/*
+ ******************************************************************************
+ * @file    mount_shadow.c
+ * @brief   Shadow of settings acknowledged by the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Clients resend the target coordinates and the slew rate without a change.
+ * The last target acknowledged by the mount ('1' reply of :Sr / :Sd) and the
+ * last rate sent are kept, repeated commands are answered locally.
+ *
+ * A shadow value is dropped when it gets older than MOUNT_SHADOW_MAX_AGE_MS or
+ * when a mount reply timed out since it was stored, the mount may have been
+ * reset or operated with the hand controller.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <string.h>
+#include "main.h"
+#include "mount_reply.h"
+#include "mount_shadow.h"
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    char value[MOUNT_SHADOW_TARGET_LEN];
+    uint32_t tick;
+    uint32_t timeouts;      // mount reply timeouts when stored
+    uint8_t valid;
+} shadow_entry_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static shadow_entry_t target[2];
+static shadow_entry_t rate;
+
+/* :Sr / :Sd sent, waiting for the acknowledge */
+static char target_pending[2][MOUNT_SHADOW_TARGET_LEN];
+static uint32_t target_sequence = 0;
+static uint32_t target_pending_tag[2];
+
+static mount_shadow_stats_t shadow_stats;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint8_t shadow_matches(const shadow_entry_t* entry, const char* command)
+{
+    return entry->valid
+        && ((HAL_GetTick() - entry->tick) < MOUNT_SHADOW_MAX_AGE_MS)
+        && (entry->timeouts == mount_reply_get_stats()->timeouts)
+        && (strcmp(entry->value, command) == 0);
+}
+
+static void shadow_store(shadow_entry_t* entry, const char* command)
+{
+    if(strlen(command) >= sizeof(entry->value))
+    {
+        entry->valid = 0;   // too long to compare, always sent
+        return;
+    }
+    strcpy(entry->value, command);
+    entry->tick = HAL_GetTick();
+    entry->timeouts = mount_reply_get_stats()->timeouts;
+    entry->valid = 1;
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Target coordinate was acknowledged with this command already
+ * @param axis: MOUNT_SHADOW_RA or MOUNT_SHADOW_DEC
+ * @param command: complete command as sent to the mount
+ */
+uint8_t mount_shadow_target_unchanged(uint8_t axis, const char* command)
+{
+    return shadow_matches(&target[axis], command);
+}
+
+/**
+ * @brief A target command is sent to the mount
+ * @retval tag for mount_shadow_target_reply()
+ */
+uint32_t mount_shadow_target_sent(uint8_t axis, const char* command)
+{
+    target[axis].valid = 0;
+    strncpy(target_pending[axis], command, MOUNT_SHADOW_TARGET_LEN - 1);
+    target_pending[axis][MOUNT_SHADOW_TARGET_LEN - 1] = '\0';
+
+    target_sequence += 2;
+    target_pending_tag[axis] = target_sequence | axis;
+    return target_pending_tag[axis];
+}
+
+/**
+ * @brief Reply callback of a target command
+ */
+void mount_shadow_target_reply(const char* reply, uint32_t tag)
+{
+    uint8_t axis = tag & 1;
+
+    if(tag != target_pending_tag[axis])
+    {
+        return; // a newer target was sent in between
+    }
+    if((reply != NULL) && (reply[0] == '1'))
+    {
+        shadow_store(&target[axis], target_pending[axis]);
+    }
+}
+
+/**
+ * @brief Slew rate command equals the last one sent
+ */
+uint8_t mount_shadow_rate_unchanged(const char* command)
+{
+    return shadow_matches(&rate, command);
+}
+
+/**
+ * @brief A slew rate command is sent to the mount, it has no reply
+ */
+void mount_shadow_rate_sent(const char* command)
+{
+    shadow_store(&rate, command);
+}
+
+/**
+ * @brief A command was answered from the shadow
+ * @param bytes: command and reply bytes not sent over the link
+ */
+void mount_shadow_saved(uint32_t bytes)
+{
+    shadow_stats.suppressed++;
+    shadow_stats.bytes_saved += bytes;
+}
+
+const mount_shadow_stats_t* mount_shadow_get_stats(void)
+{
+    return &shadow_stats;
+}
@@ -0,0 +1,51 @@
+/*
+ ******************************************************************************
+ * @file    mount_shadow.h
+ * @brief   Header for the shadow of settings acknowledged by the mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef MOUNT_SHADOW_H
+#define MOUNT_SHADOW_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* a shadow value older than this is not trusted anymore (hand controller, mount reset) */
+#ifndef MOUNT_SHADOW_MAX_AGE_MS
+#define MOUNT_SHADOW_MAX_AGE_MS     600000
+#endif
+/* longest :Sr / :Sd command kept */
+#define MOUNT_SHADOW_TARGET_LEN     20
+
+#define MOUNT_SHADOW_RA             0
+#define MOUNT_SHADOW_DEC            1
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef struct {
+    uint32_t suppressed;        // commands not sent because nothing changed
+    uint32_t bytes_saved;       // link bytes saved, both directions
+} mount_shadow_stats_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+uint8_t mount_shadow_target_unchanged(uint8_t axis, const char* command);
+uint32_t mount_shadow_target_sent(uint8_t axis, const char* command);
+void mount_shadow_target_reply(const char* reply, uint32_t tag);
+uint8_t mount_shadow_rate_unchanged(const char* command);
+void mount_shadow_rate_sent(const char* command);
+void mount_shadow_saved(uint32_t bytes);
+const mount_shadow_stats_t* mount_shadow_get_stats(void);
+
+#endif // MOUNT_SHADOW_H
@@ -0,0 +1,58 @@
+/*
+ ******************************************************************************
+ * @file    perf_counter.h
+ * @brief   Cycle accurate timing with the Cortex-M3 DWT cycle counter
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef PERF_COUNTER_H
+#define PERF_COUNTER_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+#include "main.h"
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+#define PERF_CYCLES_TO_US(cycles)   ((cycles) / (SystemCoreClock / 1000000U))
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Enable the DWT cycle counter (runs at core clock, 72MHz)
+ */
+static inline void perf_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t perf_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Update a maximum with the cycles elapsed since start
+ * @retval elapsed cycles
+ */
+static inline uint32_t perf_track_max(volatile uint32_t* max_cycles, uint32_t start)
+{
+    uint32_t elapsed = DWT->CYCCNT - start;
+
+    if(elapsed > *max_cycles)
+    {
+        *max_cycles = elapsed;
+    }
+    return elapsed;
+}
+
+#endif // PERF_COUNTER_H
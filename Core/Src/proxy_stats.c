@@ -0,0 +1,74 @@
+/*
+ ******************************************************************************
+ * @file    proxy_stats.c
+ * @brief   Runtime counters of the proxy
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Collects the counters kept by the modules into one frame. Nothing is
+ * counted here, the frame is only formatted on request, so polling it costs
+ * a single snprintf in the main loop and does not touch the ST4 outputs.
+ *
+ * :XS# reply, comma separated decimal values:
+ *   usb_in,usb_out,usb_drop,mnt_in,mnt_out,mnt_drop,dbg_out,
+ *   cmds,parse_ovf,queue_ovf,ore,fe,rx_restarts,
+ *   guide_n,guide_s,guide_e,guide_w,loop_us,usb_isr_us,uptime_s#
+ *   usb_drop: bytes rejected by the CDC ring buffer (USB busy)
+ *   mnt_drop: bytes lost on the mount link (receive and transmit)
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include "main.h"
+#include "perf_counter.h"
+#include "usbd_cdc_if.h"
+#include "lx200_server.h"
+#include "mount_link.h"
+#include "st4_handler.h"
+#include "proxy_stats.h"
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+extern volatile uint32_t usb_isr_max_cycles;
+extern volatile uint32_t main_loop_max_cycles;
+extern uint32_t debug_tx_bytes;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Format all counters, see the file header for the format
+ * @param out: buffer, PROXY_STATS_FRAME_SIZE is always enough
+ * @retval length of the frame
+ */
+uint16_t proxy_stats_format(char* out, uint16_t size)
+{
+    const LX200_Stats_t* lx200 = GetLX200Stats();
+    const CDC_TxStatsTypeDef* cdc = CDC_GetTxStats_FS();
+    const mount_link_stats_t* link = mount_link_get_stats();
+
+    int len = snprintf(out, size,
+                       "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu#",
+                       (unsigned long)lx200->rx_bytes, (unsigned long)cdc->queued, (unsigned long)cdc->dropped,
+                       (unsigned long)link->rx_bytes, (unsigned long)link->tx_bytes,
+                       (unsigned long)(link->rx_dropped + link->tx_dropped), (unsigned long)debug_tx_bytes,
+                       (unsigned long)lx200->commands, (unsigned long)lx200->parser_overflows,
+                       (unsigned long)lx200->queue_overflows, (unsigned long)link->overruns,
+                       (unsigned long)link->framing_errors, (unsigned long)link->rx_restarts,
+                       (unsigned long)st4_get_pulses(ST4_NORTH), (unsigned long)st4_get_pulses(ST4_SOUTH),
+                       (unsigned long)st4_get_pulses(ST4_EAST), (unsigned long)st4_get_pulses(ST4_WEST),
+                       (unsigned long)PERF_CYCLES_TO_US(main_loop_max_cycles),
+                       (unsigned long)PERF_CYCLES_TO_US(usb_isr_max_cycles),
+                       (unsigned long)(HAL_GetTick() / 1000));
+
+    if(len < 0)
+    {
+        return 0;
+    }
+    return (len < size) ? (uint16_t)len : (uint16_t)(size - 1);
+}
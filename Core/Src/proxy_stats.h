@@ -0,0 +1,30 @@
+/*
+ ******************************************************************************
+ * @file    proxy_stats.h
+ * @brief   Header for the runtime counters of the proxy
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef PROXY_STATS_H
+#define PROXY_STATS_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* size of the buffer for proxy_stats_format(), including the '#' */
+#define PROXY_STATS_FRAME_SIZE  192
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+uint16_t proxy_stats_format(char* out, uint16_t size);
+
+#endif // PROXY_STATS_H
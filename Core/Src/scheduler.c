@@ -0,0 +1,265 @@
+/*
+ ******************************************************************************
+ * @file    scheduler.c
+ * @brief   Tick based deadline scheduler, tasks run to completion in the main loop
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Periodic and one-shot tasks share the slots, a slot stays with its task
+ * after a one-shot run or sched_stop() so the statistics are kept. One task
+ * runs per main loop pass, the most overdue first: USB commands and mount
+ * replies are handled between two tasks, a slow task delays guide commands
+ * by its own run time only.
+ *
+ * Per task the run time is measured with the cycle counter, a run longer than
+ * the budget counts as overrun. Periodic tasks keep their due ticks on the
+ * period grid, periods missed completely are counted and skipped.
+ *
+ * :XT# reply, one entry per task:
+ *   "<name>:<period_ms>,<budget_us>,<runs>,<mean_us>,<max_us>,<overruns>,<late_max_ms>,<missed>;" ... "#"
+ * ("+#" at the end if tasks were left out, answer too long)
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+#include "perf_counter.h"
+#include "scheduler.h"
+#include "event_loop.h"
+
+/* ============================================================================
+ *                         PRIVATE TYPES & STRUCTS
+ * ============================================================================ */
+typedef struct {
+    const sched_task_t* task;   // NULL if the slot is free
+    void* context;
+    uint32_t due_tick;
+    uint8_t active;             // waiting for its due tick
+    uint32_t runs;
+    uint32_t overruns;          // runs longer than the budget
+    uint32_t missed;            // periods skipped, the task started too late
+    uint32_t late_max_ms;       // latest start after the due tick
+    uint32_t max_cycles;
+    uint64_t sum_cycles;
+} sched_slot_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static sched_slot_t sched_slots[SCHED_MAX_TASKS] = {0};
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Slot of a task, a new one if it has none: free slots first, then
+ *        slots of stopped tasks (their statistics are lost)
+ */
+static sched_slot_t* sched_slot(const sched_task_t* task)
+{
+    sched_slot_t* stopped = NULL;
+    sched_slot_t* free_slot = NULL;
+
+    for(uint8_t i = 0; i < SCHED_MAX_TASKS; i++)
+    {
+        sched_slot_t* slot = &sched_slots[i];
+
+        if(slot->task == task)
+        {
+            return slot;
+        }
+        if((slot->task == NULL) && (free_slot == NULL))
+        {
+            free_slot = slot;
+        }
+        else if((slot->task != NULL) && !slot->active && (stopped == NULL))
+        {
+            stopped = slot;
+        }
+    }
+
+    sched_slot_t* slot = (free_slot != NULL) ? free_slot : stopped;
+
+    if(slot != NULL)
+    {
+        *slot = (sched_slot_t){ .task = task };
+    }
+    return slot;
+}
+
+/**
+ * @brief Active slot with the oldest due tick
+ */
+static sched_slot_t* sched_earliest(void)
+{
+    sched_slot_t* earliest = NULL;
+
+    for(uint8_t i = 0; i < SCHED_MAX_TASKS; i++)
+    {
+        sched_slot_t* slot = &sched_slots[i];
+
+        /* int32_t cast handles HAL_GetTick() overflow correctly */
+        if(slot->active && ((earliest == NULL) || ((int32_t)(slot->due_tick - earliest->due_tick) < 0)))
+        {
+            earliest = slot;
+        }
+    }
+    return earliest;
+}
+
+/**
+ * @brief Count a run of a task
+ */
+static void sched_account(sched_slot_t* slot, uint32_t late_ms, uint32_t cycles)
+{
+    slot->runs++;
+    slot->sum_cycles += cycles;
+    if(cycles > slot->max_cycles)
+    {
+        slot->max_cycles = cycles;
+    }
+    if(late_ms > slot->late_max_ms)
+    {
+        slot->late_max_ms = late_ms;
+    }
+    if((slot->task->budget_us != 0) && (PERF_CYCLES_TO_US(cycles) > slot->task->budget_us))
+    {
+        slot->overruns++;
+        DEBUG_PRINTF(UART_DEBUG, "!! task %s: %lu us, budget %lu us\r\n", slot->task->name,
+                     (unsigned long)PERF_CYCLES_TO_US(cycles), (unsigned long)slot->task->budget_us);
+    }
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Start a task, a running task is restarted
+ * @param task: task definition
+ * @param delay_ms: delay of the first run in milliseconds (HAL tick)
+ * @param context: passed to the callback
+ * @retval 1 if scheduled, 0 if all slots are in use
+ */
+uint8_t sched_start(const sched_task_t* task, uint32_t delay_ms, void* context)
+{
+    sched_slot_t* slot = sched_slot(task);
+
+    if(slot == NULL)
+    {
+        return 0;
+    }
+    slot->due_tick = HAL_GetTick() + delay_ms;
+    slot->context = context;
+    slot->active = 1;
+    return 1;
+}
+
+/**
+ * @brief Stop a task, its statistics are kept
+ */
+void sched_stop(const sched_task_t* task)
+{
+    for(uint8_t i = 0; i < SCHED_MAX_TASKS; i++)
+    {
+        if(sched_slots[i].task == task)
+        {
+            sched_slots[i].active = 0;
+        }
+    }
+}
+
+/**
+ * @brief Time until the next task is due
+ * @retval ms, EVENT_NO_DEADLINE without active tasks
+ */
+uint32_t sched_next_ms(void)
+{
+    sched_slot_t* slot = sched_earliest();
+
+    if(slot == NULL)
+    {
+        return EVENT_NO_DEADLINE;
+    }
+    return event_ms_until(slot->due_tick, HAL_GetTick());
+}
+
+/**
+ * @brief Task table as one answer, see the file header for the format
+ */
+void sched_format(char* buffer, uint16_t size)
+{
+    char line[112];
+    uint16_t used = 0;
+
+    for(uint8_t i = 0; i < SCHED_MAX_TASKS; i++)
+    {
+        const sched_slot_t* slot = &sched_slots[i];
+
+        if(slot->task == NULL)
+        {
+            continue;
+        }
+        uint32_t mean_cycles = (slot->runs > 0) ? (uint32_t)(slot->sum_cycles / slot->runs) : 0;
+
+        snprintf(line, sizeof(line), "%.8s:%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu;", slot->task->name,
+                 (unsigned long)slot->task->period_ms, (unsigned long)slot->task->budget_us,
+                 (unsigned long)slot->runs, (unsigned long)PERF_CYCLES_TO_US(mean_cycles),
+                 (unsigned long)PERF_CYCLES_TO_US(slot->max_cycles), (unsigned long)slot->overruns,
+                 (unsigned long)slot->late_max_ms, (unsigned long)slot->missed);
+        // room for "+#" and the terminator
+        if(used + strlen(line) + 3 > size)
+        {
+            snprintf(&buffer[used], size - used, "+#");
+            return;
+        }
+        memcpy(&buffer[used], line, strlen(line));
+        used += strlen(line);
+    }
+    snprintf(&buffer[used], size - used, "#");
+}
+
+/* ----------------------------------------------------------------------------
+ *                         SCHEDULER CYCLIC PROCESSING
+ * ---------------------------------------------------------------------------- */
+void sched_process(void)
+{
+    uint32_t now = HAL_GetTick();
+    sched_slot_t* slot = sched_earliest();
+
+    if((slot == NULL) || ((int32_t)(now - slot->due_tick) < 0))
+    {
+        return;
+    }
+
+    const sched_task_t* task = slot->task;
+    uint32_t late_ms = now - slot->due_tick;
+
+    // next due tick first, the callback may restart or stop the task
+    if(task->period_ms == 0)
+    {
+        slot->active = 0;
+    }
+    else
+    {
+        uint32_t periods = late_ms / task->period_ms;
+
+        slot->missed += periods;
+        slot->due_tick += (periods + 1) * task->period_ms;
+    }
+
+    uint32_t start = perf_cycles();
+    task->callback(slot->context);
+    uint32_t cycles = perf_cycles() - start;
+
+    // the slot of a finished one-shot task may have been taken over by the callback
+    if(slot->task == task)
+    {
+        sched_account(slot, late_ms, cycles);
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ ******************************************************************************
+ * @file    scheduler.h
+ * @brief   Header for tick based deadline scheduler
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+#define SCHED_MAX_TASKS     8
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef void (*sched_callback_t)(void* context);
+
+/* task definition, const in flash, its address identifies the task */
+typedef struct {
+    const char* name;           // short name for :XT#
+    sched_callback_t callback;
+    uint32_t period_ms;         // 0: one-shot
+    uint32_t budget_us;         // longest expected run, 0 without limit
+} sched_task_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+uint8_t sched_start(const sched_task_t* task, uint32_t delay_ms, void* context);
+void sched_stop(const sched_task_t* task);
+uint32_t sched_next_ms(void);
+void sched_process(void);
+void sched_format(char* buffer, uint16_t size);
+
+#endif // SCHEDULER_H
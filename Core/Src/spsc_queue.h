@@ -0,0 +1,161 @@
+/*
+ ******************************************************************************
+ * @file    spsc_queue.h
+ * @brief   Lock-free single producer / single consumer byte queue
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+#include "main.h"  // For CMSIS barrier intrinsics
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+/* head is only written by the producer, tail only by the consumer */
+/* size must be a power of two, indices run freely and wrap with the mask */
+typedef struct {
+    uint8_t* buffer;
+    uint32_t mask;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} spsc_queue_t;
+
+/* optional time stamps of the pushed blocks, entry n ends at queue position end */
+typedef struct {
+    uint32_t end;
+    uint32_t cycles;
+} spsc_stamp_t;
+
+typedef struct {
+    spsc_stamp_t* stamps;
+    uint32_t mask;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} spsc_stamps_t;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+static inline void spsc_init(spsc_queue_t* q, uint8_t* buffer, uint32_t size)
+{
+    q->buffer = buffer;
+    q->mask = size - 1;
+    q->head = 0;
+    q->tail = 0;
+}
+
+static inline uint32_t spsc_used(const spsc_queue_t* q)
+{
+    return q->head - q->tail;
+}
+
+static inline uint32_t spsc_free(const spsc_queue_t* q)
+{
+    return (q->mask + 1) - (q->head - q->tail);
+}
+
+/**
+ * @brief Producer side: copy a block into the queue
+ * @retval 1 if the block was queued, 0 if there was not enough space (nothing queued)
+ */
+static inline uint8_t spsc_push(spsc_queue_t* q, const uint8_t* data, uint32_t length)
+{
+    uint32_t head = q->head;
+
+    if(((q->mask + 1) - (head - q->tail)) < length)
+    {
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        q->buffer[(head + i) & q->mask] = data[i];
+    }
+
+    __DMB(); // data must be visible before the new head
+    q->head = head + length;
+    return 1;
+}
+
+/**
+ * @brief Consumer side: take up to max_length bytes out of the queue
+ * @retval number of bytes copied
+ */
+static inline uint32_t spsc_pop(spsc_queue_t* q, uint8_t* data, uint32_t max_length)
+{
+    uint32_t tail = q->tail;
+    uint32_t count = q->head - tail;
+
+    if(count > max_length)
+    {
+        count = max_length;
+    }
+
+    __DMB(); // read data only after the head was read
+    for(uint32_t i = 0; i < count; i++)
+    {
+        data[i] = q->buffer[(tail + i) & q->mask];
+    }
+
+    __DMB(); // data must be read before the slots are released
+    q->tail = tail + count;
+    return count;
+}
+
+/**
+ * @brief Producer side: stamp the block pushed last
+ * @note  without a free stamp the block gets the time of the next one
+ */
+static inline void spsc_stamp(spsc_stamps_t* s, const spsc_queue_t* q, uint32_t cycles)
+{
+    uint32_t head = s->head;
+
+    if((head - s->tail) <= s->mask)
+    {
+        s->stamps[head & s->mask].end = q->head;
+        s->stamps[head & s->mask].cycles = cycles;
+        __DMB(); // stamp must be visible before the new head
+        s->head = head + 1;
+    }
+}
+
+/**
+ * @brief Consumer side: limit the next pop to the current block and get its stamp
+ * @param limit: maximum number of bytes to pop
+ * @param cycles: stamp of the block, unchanged if there is none
+ * @retval number of bytes to pop
+ */
+static inline uint32_t spsc_stamp_limit(spsc_stamps_t* s, const spsc_queue_t* q, uint32_t limit, uint32_t* cycles)
+{
+    while(s->tail != s->head)
+    {
+        __DMB(); // read the stamp only after the head was read
+        const spsc_stamp_t* stamp = &s->stamps[s->tail & s->mask];
+        int32_t until = (int32_t)(stamp->end - q->tail);
+
+        *cycles = stamp->cycles;
+        if(until > 0)
+        {
+            if((uint32_t)until <= limit)
+            {
+                limit = until;
+                s->tail++;
+            }
+            break;
+        }
+        // block was popped before its stamp was written
+        s->tail++;
+    }
+    return limit;
+}
+
+#endif // SPSC_QUEUE_H
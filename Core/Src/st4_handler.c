@@ -5,34 +5,80 @@
  * @author  Sven Lissel
  * @date    2025
  ******************************************************************************
+ *
+ * The pins are switched on by st4_commit() after st4_pulse() and switched off
+ * by the compare interrupt of TIM2, one channel per direction (PB12..PB15 have no timer
+ * output, so the ISR writes the pin). TIM2 runs free at 1 MHz, pulses longer
+ * than ST4_CHUNK_US are scheduled in several compare steps.
+ *
+ * North / South and East / West form an axis, only one direction of an axis
+ * is active at a time. A pulse for the active direction is handled by the
+ * policy (replace, extend or queue, ST4_QUEUE_DEPTH pulses per axis), a pulse
+ * for the opposite direction cancels the active one or is netted against its
+ * remaining time. Queued pulses follow back to back from the compare ISR.
+ *
+ * Pin edges are collected in set / reset masks and written with one BSRR
+ * access: st4_pulse() only stages its edges, st4_commit() (main loop, after
+ * the commands of a pass) switches all of them and starts their compares on
+ * the same counter value, so RA and Dec corrections begin on the same cycle.
+ * The ISR writes the ends of all pulses due in the same interrupt at once.
  */
 
 /* ============================================================================
  *                              INCLUDES
  * ============================================================================ */
 #include "st4_handler.h"
+#include "perf_counter.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define ST4_TIMER               TIM2
+#define ST4_TIMER_HZ            1000000U
+/* longest compare step, well below the 16 bit counter period */
+#define ST4_CHUNK_US            0x8000U
+#define ST4_US_PER_TICK         (ST4_TIMER_HZ / (1000U * ST4_TICKS_PER_MS))
 
 /* ============================================================================
  *                         PRIVATE TYPES & STRUCTS
  * ============================================================================ */
-/* using ticktimes to be safe for race conditions with interrupts */
-/* setter functiions only sets tick time for off timepoint */
+/* written by st4_pulse() with interrupts disabled and by the timer ISR */
 typedef struct {
-    volatile uint8_t active;
-    volatile int32_t off_ticktime;
+    volatile uint8_t active;        // running or staged
+    volatile uint32_t remaining;    // us after the programmed compare
+    uint32_t on_cycles;             // cycle counter at the on edge
+    uint32_t expected_cycles;       // requested length from the on edge
 } ST4_Pin_State_t;
 
+/* axis descriptor with the pulses waiting for its active direction */
 typedef struct {
-    volatile ST4_Pin_State_t north;
-    volatile ST4_Pin_State_t south;
-    volatile ST4_Pin_State_t east; 
-    volatile ST4_Pin_State_t west;
-} ST4_States_t;
+    uint16_t pins;                      // pins of both directions
+    uint32_t queue[ST4_QUEUE_DEPTH];    // lengths in ticks
+    uint8_t head;
+    uint8_t count;
+} ST4_Axis_t;
 
 /* ============================================================================
  *                         PRIVATE VARIABLES
  * ============================================================================ */
-static ST4_States_t st4_states = {0};
+static ST4_Pin_State_t st4_states[4] = {0};
+static uint32_t st4_pulses[4] = {0};
+static ST4_Accuracy_t st4_accuracy = {0};
+
+static ST4_Axis_t st4_axes[ST4_AXES] = {
+    { .pins = ST4_NORTH_Pin | ST4_SOUTH_Pin },
+    { .pins = ST4_EAST_Pin | ST4_WEST_Pin }
+};
+static ST4_Policy_t st4_policy = ST4_POLICY_REPLACE;
+static ST4_Opposing_t st4_opposing = ST4_OPPOSING_CANCEL;
+static ST4_Guide_Stats_t st4_guide_stats = {0};
+
+static const uint16_t st4_pins[4] = { ST4_NORTH_Pin, ST4_SOUTH_Pin, ST4_EAST_Pin, ST4_WEST_Pin };
+
+/* edges for st4_commit(), pins are active low: on = reset, off = set */
+static uint16_t st4_staged_on = 0;
+static uint16_t st4_staged_off = 0;
+static uint8_t st4_staged = 0;          // directions whose compare starts at the commit
 
 #define ENABLE_DEBUG_PRINTF 0
 
@@ -43,16 +89,217 @@ static ST4_States_t st4_states = {0};
     #define DEBUG_PRINTF(...)
 #endif
 
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Program the next compare step of a direction
+ * @param from: counter value the step starts at
+ */
+static void st4_schedule(uint8_t direction, uint32_t from)
+{
+    ST4_Pin_State_t* state = &st4_states[direction];
+    uint32_t step = (state->remaining > ST4_CHUNK_US) ? ST4_CHUNK_US : state->remaining;
+
+    state->remaining -= step;
+    (&ST4_TIMER->CCR1)[direction] = (from + step) & 0xFFFFU;
+    ST4_TIMER->SR = ~(TIM_SR_CC1IF << direction);
+    ST4_TIMER->DIER |= (TIM_DIER_CC1IE << direction);
+}
+
+/**
+ * @brief Count the length error of a pulse that ran to its end
+ */
+static void st4_measure(const ST4_Pin_State_t* state)
+{
+    int32_t error_cycles = (int32_t)((perf_cycles() - state->on_cycles) - state->expected_cycles);
+    int32_t error_us = error_cycles / (int32_t)(SystemCoreClock / 1000000U);
+
+    if((st4_accuracy.pulses == 0) || (error_us < st4_accuracy.min_error_us))
+    {
+        st4_accuracy.min_error_us = error_us;
+    }
+    if((st4_accuracy.pulses == 0) || (error_us > st4_accuracy.max_error_us))
+    {
+        st4_accuracy.max_error_us = error_us;
+    }
+    st4_accuracy.sum_error_us += error_us;
+    st4_accuracy.pulses++;
+}
+
+/**
+ * @brief Stop a direction, pulses queued for it are dropped
+ * @retval pin to switch off, 0 if the direction was only staged
+ */
+static uint16_t st4_stop(uint8_t direction)
+{
+    ST4_Axis_t* axis = &st4_axes[direction / 2];
+    uint16_t pin = st4_pins[direction];
+
+    ST4_TIMER->DIER &= ~(TIM_DIER_CC1IE << direction);
+    st4_states[direction].active = 0;
+    st4_guide_stats.cancelled += axis->count;
+    axis->count = 0;
+
+    if(st4_staged & (1U << direction))
+    {
+        st4_staged &= ~(1U << direction);
+        st4_staged_on &= ~pin;
+        return 0;
+    }
+    return pin;
+}
+
+/**
+ * @brief Stage the end of a pulse for st4_commit() (interrupts disabled)
+ */
+static void st4_off(uint8_t direction)
+{
+    uint16_t pin = st4_stop(direction);
+
+    st4_staged_on &= ~pin;
+    st4_staged_off |= pin;
+}
+
+/**
+ * @brief Stage a direction for st4_commit() or set the new length of its running pulse (interrupts disabled)
+ * @param ticks: length from now, or from the commit for a staged direction
+ */
+static void st4_start(uint8_t direction, uint32_t ticks)
+{
+    ST4_Pin_State_t* state = &st4_states[direction];
+    uint32_t cycles = ticks * (SystemCoreClock / (1000U * ST4_TICKS_PER_MS));
+
+    state->remaining = ticks * ST4_US_PER_TICK;
+    if(!state->active)
+    {
+        // on, and the other direction of the axis off, in the same write
+        uint16_t pin = st4_pins[direction];
+
+        state->active = 1;
+        st4_staged |= (1U << direction);
+        st4_staged_on |= pin;
+        st4_staged_off = (st4_staged_off | (st4_axes[direction / 2].pins & ~pin)) & ~pin;
+    }
+    if(st4_staged & (1U << direction))
+    {
+        state->expected_cycles = cycles;
+        return;
+    }
+    state->expected_cycles = (perf_cycles() - state->on_cycles) + cycles;
+    st4_schedule(direction, ST4_TIMER->CNT);
+}
+
+/**
+ * @brief Time left of the running pulse of a direction in ticks (interrupts disabled)
+ */
+static uint32_t st4_remaining_ticks(uint8_t direction)
+{
+    const ST4_Pin_State_t* state = &st4_states[direction];
+    uint32_t us = state->remaining;
+
+    // a matched compare waiting for the ISR has no time left in its step,
+    // a staged direction has no compare yet
+    if(!(ST4_TIMER->SR & (TIM_SR_CC1IF << direction)) && !(st4_staged & (1U << direction)))
+    {
+        us += ((&ST4_TIMER->CCR1)[direction] - ST4_TIMER->CNT) & 0xFFFFU;
+    }
+    return (us + ST4_US_PER_TICK / 2) / ST4_US_PER_TICK;
+}
+
+/**
+ * @brief New pulse for the active direction of its axis, handled by the policy
+ */
+static void st4_merge(uint8_t direction, uint32_t ticks)
+{
+    ST4_Axis_t* axis = &st4_axes[direction / 2];
+
+    switch(st4_policy)
+    {
+        case ST4_POLICY_EXTEND:
+            st4_start(direction, st4_remaining_ticks(direction) + ticks);
+            st4_guide_stats.extended++;
+            break;
+        case ST4_POLICY_QUEUE:
+            if(axis->count < ST4_QUEUE_DEPTH)
+            {
+                axis->queue[(axis->head + axis->count) % ST4_QUEUE_DEPTH] = ticks;
+                axis->count++;
+                st4_guide_stats.queued++;
+            }
+            else
+            {
+                st4_guide_stats.dropped++;
+            }
+            break;
+        case ST4_POLICY_REPLACE:
+        default:
+            st4_start(direction, ticks);
+            st4_guide_stats.replaced++;
+            break;
+    }
+}
+
+/**
+ * @brief Pulse against the running opposite direction (interrupts disabled)
+ * @retval ticks left for the new direction, 0 if nothing is to start
+ */
+static uint32_t st4_oppose(uint8_t direction, uint32_t ticks)
+{
+    uint8_t opposite = direction ^ 1;
+
+    if(st4_opposing == ST4_OPPOSING_NET)
+    {
+        uint32_t left = st4_remaining_ticks(opposite);
+
+        st4_guide_stats.netted++;
+        if(left > ticks)
+        {
+            // queued pulses of the opposite direction stay
+            st4_start(opposite, left - ticks);
+            return 0;
+        }
+        st4_off(opposite);
+        return ticks - left;
+    }
+
+    st4_off(opposite);
+    st4_guide_stats.cancelled++;
+    return ticks;
+}
+
 /* ============================================================================
  *                         PUBLIC FUNCTIONS
  * ============================================================================ */
 
+/**
+ * @brief Start TIM2 as free running 1 MHz counter for the pulse lengths
+ * @note  the USB interrupt gets a lower priority, the USB ISR only queues data
+ */
+void st4_init(void)
+{
+    __HAL_RCC_TIM2_CLK_ENABLE();
+
+    // APB1 runs at HCLK / 2, so the timer clock is HCLK
+    ST4_TIMER->CR1 = 0;
+    ST4_TIMER->PSC = (SystemCoreClock / ST4_TIMER_HZ) - 1U;
+    ST4_TIMER->ARR = 0xFFFFU;
+    ST4_TIMER->DIER = 0;
+    ST4_TIMER->EGR = TIM_EGR_UG;    // load the prescaler
+    ST4_TIMER->SR = 0;
+    ST4_TIMER->CR1 = TIM_CR1_CEN;
+
+    HAL_NVIC_SetPriority(TIM2_IRQn, ST4_TIMER_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
  /**
  * @brief Extract duration from guiding command for ST4 movement
  * @param command: Full LX200 command string
  * @retval Duration in milliseconds
  */
-uint32_t st4_parse_duration(char* command)
+uint32_t st4_parse_duration(const char* command)
 {
     if(strlen(command) > 5) 
     {
@@ -69,103 +316,216 @@ uint32_t st4_parse_duration(char* command)
     }
 }
 
+/**
+ * @brief Guide pulse in ms, see st4_pulse()
+ */
 void st4_set(ST4_Direction_t direction, uint32_t duration_ms)
 {
-    uint32_t time2set = HAL_GetTick() + duration_ms;
-
-    switch(direction)
-    {
-        case ST4_NORTH:
-                st4_states.north.off_ticktime = time2set;
-            break;
-        case ST4_SOUTH:
-                st4_states.south.off_ticktime = time2set;
-            break;
-        case ST4_EAST:
-                st4_states.east.off_ticktime = time2set;
-            break;
-        case ST4_WEST:
-                st4_states.west.off_ticktime = time2set;
-            break;     
-        default:
-            return;
-    }
+    st4_pulse(direction, duration_ms * ST4_TICKS_PER_MS);
 }
 
-/* ----------------------------------------------------------------------------
- *                         ST4 CYCLIC PROCESSING
- * ---------------------------------------------------------------------------- */
-void st4_process(void)
+/**
+ * @brief Guide pulse, see the file header for the policies, the edges are
+ *        switched by the next st4_commit()
+ * @param ticks: length in 1 / ST4_TICKS_PER_MS ms, 0 stops the direction and its queue
+ */
+void st4_pulse(ST4_Direction_t direction, uint32_t ticks)
 {
-    int32_t remaining_ticks;
-    /* int32_t cast handles HAL_GetTick() overflow correctly (two's complement arithmetic) */
-    /* Race condition safe: interrupt only writes off_ticktime, process only reads it atomically */
-
-    /* North */
-    remaining_ticks = (int32_t)(st4_states.north.off_ticktime - HAL_GetTick());
-    if((!st4_states.north.active) && (remaining_ticks > 0))
+    if(direction > ST4_WEST)
     {
-        //turn on!
-        st4_states.north.active = 1;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_NORTH_Pin, GPIO_PIN_RESET); // signal is active low
-        DEBUG_PRINTF(UART_DEBUG, "ST4 North: ON %dms\r\n", remaining_ticks);
+        return;
     }
-    else if((st4_states.north.active) && (remaining_ticks <= 0))
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(ticks == 0)
     {
-        // switch off!
-        st4_states.north.active = 0;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_NORTH_Pin, GPIO_PIN_SET); // set to floating (high impedance)
-        DEBUG_PRINTF(UART_DEBUG, "ST4 North: OFF\r\n");
+        if(st4_states[direction].active)
+        {
+            st4_off(direction);
+        }
+        __set_PRIMASK(primask);
+        return;
     }
+    st4_pulses[direction]++;
 
-    /* South */
-    remaining_ticks = (int32_t)(st4_states.south.off_ticktime - HAL_GetTick());
-    if((!st4_states.south.active) && (remaining_ticks > 0))
+    if(st4_states[direction ^ 1].active)
     {
-        //turn on!
-        st4_states.south.active = 1;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_SOUTH_Pin, GPIO_PIN_RESET); // signal is active low
-        DEBUG_PRINTF(UART_DEBUG, "ST4 South: ON %dms\r\n", remaining_ticks);
+        ticks = st4_oppose(direction, ticks);
     }
-    else if((st4_states.south.active) && (remaining_ticks <= 0))
+    if(ticks > 0)
     {
-        // switch off!
-        st4_states.south.active = 0;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_SOUTH_Pin, GPIO_PIN_SET); // set to floating (high impedance)
-        DEBUG_PRINTF(UART_DEBUG, "ST4 South: OFF\r\n");
+        if(st4_states[direction].active)
+        {
+            st4_merge(direction, ticks);
+        }
+        else
+        {
+            st4_start(direction, ticks);
+        }
     }
 
-    /* East */
-    remaining_ticks = (int32_t)(st4_states.east.off_ticktime - HAL_GetTick());
-    if((!st4_states.east.active) && (remaining_ticks > 0))
+    __set_PRIMASK(primask);
+    DEBUG_PRINTF(UART_DEBUG, "ST4 %d: ON %lu ticks\r\n", (int)direction, (unsigned long)ticks);
+}
+
+/**
+ * @brief Apply the staged edges with one BSRR write and start their compares
+ *        on the same counter value (main loop, after the commands of a pass)
+ */
+void st4_commit(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if((st4_staged_on | st4_staged_off) != 0)
     {
-        //turn on!
-        st4_states.east.active = 1;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_EAST_Pin, GPIO_PIN_RESET); // signal is active low
-        DEBUG_PRINTF(UART_DEBUG, "ST4 East: ON %dms\r\n", remaining_ticks);
+        uint32_t from = ST4_TIMER->CNT;
+
+        ST4_PORT->BSRR = ((uint32_t)st4_staged_on << 16) | st4_staged_off;
+        uint32_t now = perf_cycles();
+
+        for(uint8_t direction = 0; direction <= ST4_WEST; direction++)
+        {
+            if(st4_staged & (1U << direction))
+            {
+                st4_states[direction].on_cycles = now;
+                st4_schedule(direction, from);
+            }
+        }
+        st4_staged = 0;
+        st4_staged_on = 0;
+        st4_staged_off = 0;
     }
-    else if((st4_states.east.active) && (remaining_ticks <= 0))
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief TIM2 compare interrupt, next step or end of a pulse,
+ *        all pulses ending in this interrupt are switched off in one write
+ */
+void st4_timer_irq(void)
+{
+    uint16_t off = 0;
+    uint8_t ended = 0;
+
+    for(uint8_t direction = 0; direction <= ST4_WEST; direction++)
     {
-        // switch off!
-        st4_states.east.active = 0;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_EAST_Pin, GPIO_PIN_SET); // set to floating (high impedance)
-        DEBUG_PRINTF(UART_DEBUG, "ST4 East: OFF\r\n");
+        uint32_t flag = TIM_SR_CC1IF << direction;
+
+        if((ST4_TIMER->SR & flag) && (ST4_TIMER->DIER & (TIM_DIER_CC1IE << direction)))
+        {
+            ST4_TIMER->SR = ~flag;
+            ST4_Pin_State_t* state = &st4_states[direction];
+            ST4_Axis_t* axis = &st4_axes[direction / 2];
+            uint32_t ccr = (&ST4_TIMER->CCR1)[direction];
+
+            if(state->remaining > 0)
+            {
+                st4_schedule(direction, ccr);
+                continue;
+            }
+            if(axis->count > 0)
+            {
+                // next queued pulse follows without a gap, the pin stays on
+                uint32_t ticks = axis->queue[axis->head];
+
+                st4_measure(state);
+                axis->head = (axis->head + 1) % ST4_QUEUE_DEPTH;
+                axis->count--;
+                state->on_cycles = perf_cycles();
+                state->expected_cycles = ticks * (SystemCoreClock / (1000U * ST4_TICKS_PER_MS));
+                state->remaining = ticks * ST4_US_PER_TICK;
+                st4_schedule(direction, ccr);
+            }
+            else
+            {
+                off |= st4_stop(direction);
+                ended |= (1U << direction);
+            }
+        }
     }
 
-    /* West */
-    remaining_ticks = (int32_t)(st4_states.west.off_ticktime - HAL_GetTick());
-    if((!st4_states.west.active) && (remaining_ticks > 0))
+    if(off != 0)
     {
-        //turn on!
-        st4_states.west.active = 1;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_WEST_Pin, GPIO_PIN_RESET); // signal is active low
-        DEBUG_PRINTF(UART_DEBUG, "ST4 West: ON %dms\r\n", remaining_ticks);
+        ST4_PORT->BSRR = off;    // set to floating (high impedance)
     }
-    else if((st4_states.west.active) && (remaining_ticks <= 0))
+    for(uint8_t direction = 0; direction <= ST4_WEST; direction++)
+    {
+        if(ended & (1U << direction))
+        {
+            st4_measure(&st4_states[direction]);
+        }
+    }
+}
+
+/**
+ * @brief Number of guide pulses issued for a direction
+ */
+uint32_t st4_get_pulses(ST4_Direction_t direction)
+{
+    return (direction <= ST4_WEST) ? st4_pulses[direction] : 0;
+}
+
+/**
+ * @brief Measured pulse length error of all finished pulses
+ */
+const ST4_Accuracy_t* st4_get_accuracy(void)
+{
+    return &st4_accuracy;
+}
+
+/**
+ * @brief Policy for pulses of an active direction and for opposite pulses
+ */
+void st4_set_policy(ST4_Policy_t policy, ST4_Opposing_t opposing)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    st4_policy = policy;
+    st4_opposing = opposing;
+    __set_PRIMASK(primask);
+}
+
+ST4_Policy_t st4_get_policy(void)
+{
+    return st4_policy;
+}
+
+ST4_Opposing_t st4_get_opposing(void)
+{
+    return st4_opposing;
+}
+
+/**
+ * @brief Pulses waiting on an axis
+ * @param axis: ST4_AXIS_DEC or ST4_AXIS_RA
+ */
+uint8_t st4_queue_depth(uint8_t axis)
+{
+    return (axis < ST4_AXES) ? st4_axes[axis].count : 0;
+}
+
+/**
+ * @brief A pulse is running, staged or queued on any axis
+ * @note  the flash of the configuration store is only written while this is 0,
+ *        the core stalls during a flash erase and so would the TIM2 interrupt
+ */
+uint8_t st4_busy(void)
+{
+    for(uint8_t i = 0; i < 4; i++)
     {
-        // switch off!
-        st4_states.west.active = 0;
-        HAL_GPIO_WritePin(ST4_PORT, ST4_WEST_Pin, GPIO_PIN_SET); // set to floating (high impedance)
-        DEBUG_PRINTF(UART_DEBUG, "ST4 West: OFF\r\n");
+        if(st4_states[i].active)
+        {
+            return 1;
+        }
     }
+    return (st4_axes[ST4_AXIS_DEC].count != 0) || (st4_axes[ST4_AXIS_RA].count != 0);
+}
+
+const ST4_Guide_Stats_t* st4_get_guide_stats(void)
+{
+    return &st4_guide_stats;
 }
@@ -19,6 +19,21 @@
 #include <string.h>
 #include "main.h"  // For HAL includes and ST4 pin definitions
 
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* guide pulse durations are given in 0.1 ms steps */
+#define ST4_TICKS_PER_MS        10
+/* NVIC priority of the pulse timer, above USB (1, set in HAL_PCD_MspInit) so an edge
+ * never waits for the USB ISR */
+#define ST4_TIMER_IRQ_PRIORITY  0
+/* pulses waiting per axis with ST4_POLICY_QUEUE */
+#define ST4_QUEUE_DEPTH         4
+/* North / South and East / West */
+#define ST4_AXIS_DEC            0
+#define ST4_AXIS_RA             1
+#define ST4_AXES                2
+
 /* ============================================================================
  *                         PUBLIC TYPES
  * ============================================================================ */
@@ -31,13 +46,55 @@ typedef enum {
     ST4_WEST = 3
 } ST4_Direction_t;
 
+/* pulse for a direction that is already active */
+typedef enum {
+    ST4_POLICY_REPLACE = 0,     // running pulse ends after the new length
+    ST4_POLICY_EXTEND,          // new length is added to the time left
+    ST4_POLICY_QUEUE            // new pulse follows the running one
+} ST4_Policy_t;
+
+/* pulse for the opposite direction of an active one */
+typedef enum {
+    ST4_OPPOSING_CANCEL = 0,    // running pulse and its queue are stopped
+    ST4_OPPOSING_NET            // lengths are netted, the longer direction runs for the difference
+} ST4_Opposing_t;
+
+typedef struct {
+    uint32_t replaced;
+    uint32_t extended;
+    uint32_t queued;
+    uint32_t dropped;           // queue of the axis full
+    uint32_t netted;
+    uint32_t cancelled;         // running or queued pulses stopped by an opposite pulse
+} ST4_Guide_Stats_t;
+
+/* pulse length measured with the cycle counter from the on to the off edge,
+ * error = measured - requested */
+typedef struct {
+    uint32_t pulses;            // pulses measured
+    int32_t min_error_us;
+    int32_t max_error_us;
+    int64_t sum_error_us;
+} ST4_Accuracy_t;
+
 /* ============================================================================
  *                         PUBLIC FUNCTION PROTOTYPES
  * ============================================================================ */
 
 // functions
-void st4_process(void);
+void st4_init(void);
 void st4_set(ST4_Direction_t direction, uint32_t duration_ms);
-uint32_t st4_parse_duration(char* command);
+void st4_pulse(ST4_Direction_t direction, uint32_t ticks);
+void st4_commit(void);
+void st4_timer_irq(void);
+const ST4_Accuracy_t* st4_get_accuracy(void);
+void st4_set_policy(ST4_Policy_t policy, ST4_Opposing_t opposing);
+ST4_Policy_t st4_get_policy(void);
+ST4_Opposing_t st4_get_opposing(void);
+uint8_t st4_queue_depth(uint8_t axis);
+uint8_t st4_busy(void);
+const ST4_Guide_Stats_t* st4_get_guide_stats(void);
+uint32_t st4_parse_duration(const char* command);
+uint32_t st4_get_pulses(ST4_Direction_t direction);
 
 #endif // ST4_HANDLER_H
\ No newline at end of file
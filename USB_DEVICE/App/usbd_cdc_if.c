@@ -62,6 +62,8 @@
   */
 
 /* USER CODE BEGIN PRIVATE_DEFINES */
+/* UserTxBufferFS is used as ring buffer, size must be a power of two */
+#define APP_TX_RING_MASK  (APP_TX_DATA_SIZE - 1U)
 /* USER CODE END PRIVATE_DEFINES */
 
 /**
@@ -94,6 +96,18 @@ uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
 uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
+/* TX ring: producers advance the head, the IN completion advances the tail */
+static volatile uint32_t TxHeadFS = 0;
+static volatile uint32_t TxTailFS = 0;
+/* number of ring bytes handed to the endpoint and not yet acknowledged */
+static volatile uint32_t TxInFlightFS = 0;
+
+static CDC_TxStatsTypeDef TxStatsFS = {0};
+
+/* OUT endpoint NAKed because the application queue is full */
+static volatile uint8_t RxPausedFS = 0;
+/* ping-pong half of UserRxBufferFS the next OUT packet is received into */
+static uint8_t RxPingPongFS = 0;
 
 /* USER CODE END PRIVATE_VARIABLES */
 
@@ -109,6 +123,7 @@ uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
 extern USBD_HandleTypeDef hUsbDeviceFS;
 
 /* USER CODE BEGIN EXPORTED_VARIABLES */
+extern PCD_HandleTypeDef hpcd_USB_FS;
 
 /* USER CODE END EXPORTED_VARIABLES */
 
@@ -125,9 +140,11 @@ static int8_t CDC_Init_FS(void);
 static int8_t CDC_DeInit_FS(void);
 static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length);
 static int8_t CDC_Receive_FS(uint8_t* pbuf, uint32_t *Len);
+static int8_t CDC_TransmitCplt_FS(uint8_t *pbuf, uint32_t *Len, uint8_t epnum);
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
-extern void USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len);
+extern uint8_t USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len);
+static void CDC_StartTransmit_FS(void);
 /* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
 
 /**
@@ -139,7 +156,8 @@ USBD_CDC_ItfTypeDef USBD_Interface_fops_FS =
   CDC_Init_FS,
   CDC_DeInit_FS,
   CDC_Control_FS,
-  CDC_Receive_FS
+  CDC_Receive_FS,
+  CDC_TransmitCplt_FS
 };
 
 /* Private functions ---------------------------------------------------------*/
@@ -151,6 +169,11 @@ static int8_t CDC_Init_FS(void)
 {
   /* USER CODE BEGIN 3 */
   /* Set Application Buffers */
+  TxHeadFS = 0;
+  TxTailFS = 0;
+  TxInFlightFS = 0;
+  RxPausedFS = 0;
+  RxPingPongFS = 0;
   USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
   return (USBD_OK);
@@ -259,9 +282,21 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 6 */
-  USB_CDC_RxHandler(Buf, *Len);
-  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
+  /* only copy the packet, it is parsed in the main loop */
+  uint8_t room = USB_CDC_RxHandler(Buf, *Len);
+
+  /* re-arm at once with the other ping-pong buffer, the double buffered
+     endpoint may already hold the next packet in its second PMA buffer */
+  RxPingPongFS ^= 1U;
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &UserRxBufferFS[RxPingPongFS * CDC_DATA_FS_OUT_PACKET_SIZE]);
   USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+
+  if (!room)
+  {
+    /* keep the endpoint NAKing until the main loop made room */
+    RxPausedFS = 1;
+    PCD_SET_EP_RX_STATUS(hpcd_USB_FS.Instance, CDC_OUT_EP & 0x0FU, USB_EP_RX_NAK);
+  }
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -271,27 +306,151 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
   *         Data to send over USB IN endpoint are sent over CDC interface
   *         through this function.
   *         @note
-  *
+  *         Data is copied into the TX ring buffer and sent as soon as the
+  *         endpoint is free, the caller's buffer can be reused on return.
+  *         Safe to call from interrupt and thread context.
   *
   * @param  Buf: Buffer of data to be sent
   * @param  Len: Number of data to be sent (in bytes)
-  * @retval USBD_OK if all operations are OK else USBD_FAIL or USBD_BUSY
+  * @retval USBD_OK if all data is queued else USBD_BUSY (ring buffer full, nothing queued)
   */
 uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
 {
   uint8_t result = USBD_OK;
   /* USER CODE BEGIN 7 */
-  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
-  if (hcdc->TxState != 0){
-    return USBD_BUSY;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint32_t used = TxHeadFS - TxTailFS;
+  if ((APP_TX_DATA_SIZE - used) < Len)
+  {
+    /* not enough space, drop the whole write to keep replies intact */
+    TxStatsFS.dropped += Len;
+    result = USBD_BUSY;
+  }
+  else
+  {
+    for (uint32_t i = 0; i < Len; i++)
+    {
+      UserTxBufferFS[(TxHeadFS + i) & APP_TX_RING_MASK] = Buf[i];
+    }
+    TxHeadFS += Len;
+    TxStatsFS.queued += Len;
+
+    if (TxInFlightFS != 0)
+    {
+      /* endpoint busy, bytes are packed into the next transfer */
+      TxStatsFS.coalesced += Len;
+    }
+    else
+    {
+      CDC_StartTransmit_FS();
+    }
   }
-  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, Buf, Len);
-  result = USBD_CDC_TransmitPacket(&hUsbDeviceFS);
+
+  __set_PRIMASK(primask);
   /* USER CODE END 7 */
   return result;
 }
 
+/**
+  * @brief  CDC_TransmitCplt_FS
+  *         Data transmitted callback
+  *
+  *         @note
+  *         This function is IN transfer complete callback used to inform user that
+  *         the submitted Data is successfully sent over USB.
+  *
+  * @param  Buf: Buffer of data to be received
+  * @param  Len: Number of data received (in bytes)
+  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
+{
+  uint8_t result = USBD_OK;
+  /* USER CODE BEGIN 13 */
+  UNUSED(Buf);
+  UNUSED(Len);
+  UNUSED(epnum);
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  TxTailFS += TxInFlightFS;
+  TxInFlightFS = 0;
+  CDC_StartTransmit_FS();
+
+  __set_PRIMASK(primask);
+  /* USER CODE END 13 */
+  return result;
+}
+
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/**
+  * @brief  Start the next IN transfer from the TX ring buffer
+  *         Sends the contiguous part of the pending bytes in one transfer,
+  *         the endpoint splits it into full 64 byte packets.
+  * @note   Must be called with interrupts disabled.
+  */
+static void CDC_StartTransmit_FS(void)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+
+  if ((hcdc == NULL) || (hcdc->TxState != 0) || (TxInFlightFS != 0))
+  {
+    return;
+  }
+
+  uint32_t pending = TxHeadFS - TxTailFS;
+  if (pending == 0)
+  {
+    return;
+  }
+
+  uint32_t start = TxTailFS & APP_TX_RING_MASK;
+  uint32_t length = APP_TX_DATA_SIZE - start;
+  if (length > pending)
+  {
+    length = pending;
+  }
+
+  TxInFlightFS = length;
+  TxStatsFS.transfers++;
+  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, &UserTxBufferFS[start], length);
+  if (USBD_CDC_TransmitPacket(&hUsbDeviceFS) != USBD_OK)
+  {
+    TxInFlightFS = 0;
+  }
+}
+
+/**
+  * @brief  CDC_ResumeReceive_FS
+  *         Accept OUT packets again if reception was paused by a full queue.
+  *         Call from thread context after the received data was consumed.
+  */
+void CDC_ResumeReceive_FS(void)
+{
+  if (RxPausedFS && (hUsbDeviceFS.pClassData != NULL))
+  {
+    /* endpoint register is read-modify-write, keep the USB interrupt out */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    RxPausedFS = 0;
+    PCD_SET_EP_RX_STATUS(hpcd_USB_FS.Instance, CDC_OUT_EP & 0x0FU, USB_EP_RX_VALID);
+    __set_PRIMASK(primask);
+  }
+}
+
+/**
+  * @brief  CDC_GetTxStats_FS
+  *         Counters of the TX ring buffer
+  * @retval Pointer to the statistics
+  */
+const CDC_TxStatsTypeDef* CDC_GetTxStats_FS(void)
+{
+  return &TxStatsFS;
+}
+
 
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
@@ -65,6 +65,14 @@
   */
 
 /* USER CODE BEGIN EXPORTED_TYPES */
+/** Counters of the USB TX ring buffer */
+typedef struct
+{
+  uint32_t queued;      /* bytes accepted by CDC_Transmit_FS */
+  uint32_t coalesced;   /* bytes queued while a transfer was in flight */
+  uint32_t dropped;     /* bytes rejected because the ring buffer was full */
+  uint32_t transfers;   /* IN transfers started */
+} CDC_TxStatsTypeDef;
 
 /* USER CODE END EXPORTED_TYPES */
 
@@ -109,6 +117,8 @@ extern USBD_CDC_ItfTypeDef USBD_Interface_fops_FS;
 uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+const CDC_TxStatsTypeDef* CDC_GetTxStats_FS(void);
+void CDC_ResumeReceive_FS(void);
 
 /* USER CODE END EXPORTED_FUNCTIONS */
 
@@ -0,0 +1,488 @@
+/*
+ ******************************************************************************
+ * @file    lx200_bench.c
+ * @brief   Throughput benchmark of the LX200 parser and dispatcher (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Feeds synthetic and recorded USB traffic through QueueLX200Data() and
+ * ProcessLX200Queue(), the same path as the USB interrupt and the main loop.
+ * The mount is prepared first (position cache, acknowledged target, slew
+ * rate), so the commands are answered by the proxy and the mount link stays
+ * idle. Virtual time does not advance while measuring.
+ *
+ * Usage: lx200_bench [--iterations N] [--scenario NAME] [--trace FILE] [--output FILE]
+ * The results are written as JSON, to stdout without --output.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fake_hal.h"
+#include "host_board.h"
+#include "lx200_server.h"
+#include "mount_link.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define BENCH_MAX_PACKETS       4096
+#define BENCH_DEFAULT_ITERATIONS 2000
+#define BENCH_ACK               0x06
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    uint8_t data[FAKE_USB_PACKET_SIZE];
+    uint8_t length;
+} packet_t;
+
+typedef struct {
+    const char* name;
+    packet_t packets[BENCH_MAX_PACKETS];
+    uint32_t count;
+    uint32_t bytes;
+} scenario_t;
+
+typedef struct {
+    uint64_t ns;
+    uint32_t bytes;
+    uint32_t commands;
+    uint32_t mount_bytes;
+    uint32_t allocations;
+    uint64_t allocated_bytes;
+} result_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+/* commands the proxy answers itself once prepared */
+static const char* const command_mix[] = {
+    ":GR#", ":GD#", ":GR#", ":GD#", ":GM#", ":Gt#", ":Gg#", ":GT#",
+    ":Sr05:35:17#", ":Sd-05*23:28#", ":RS#", ":Mgn0250#", ":Mge0120#",
+};
+#define COMMAND_MIX_SIZE    (sizeof(command_mix) / sizeof(command_mix[0]))
+
+static scenario_t scenario;
+static uint32_t random_state = 12345;
+
+/* heap use of the application, counted with the linker option --wrap */
+static uint32_t allocations = 0;
+static uint64_t allocated_bytes = 0;
+
+/* ============================================================================
+ *                         HEAP COUNTERS
+ * ============================================================================ */
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    allocations++;
+    allocated_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    allocations++;
+    allocated_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size)
+{
+    allocations++;
+    allocated_bytes += size;
+    return __real_realloc(pointer, size);
+}
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint32_t bench_random(uint32_t range)
+{
+    random_state = random_state * 1103515245U + 12345U;
+    return (random_state >> 16) % range;
+}
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void scenario_begin(const char* name)
+{
+    scenario.name = name;
+    scenario.count = 0;
+    scenario.bytes = 0;
+    random_state = 12345;
+}
+
+/**
+ * @brief Append bytes, a new packet is started when max_packet is reached
+ */
+static void scenario_append(const uint8_t* data, uint32_t length, uint8_t max_packet)
+{
+    for(uint32_t i = 0; i < length; i++)
+    {
+        packet_t* packet = (scenario.count > 0) ? &scenario.packets[scenario.count - 1] : NULL;
+
+        if((packet == NULL) || (packet->length >= max_packet))
+        {
+            if(scenario.count >= BENCH_MAX_PACKETS)
+            {
+                return;
+            }
+            packet = &scenario.packets[scenario.count++];
+            packet->length = 0;
+        }
+        packet->data[packet->length++] = data[i];
+        scenario.bytes++;
+    }
+}
+
+static void scenario_packet_end(void)
+{
+    if((scenario.count < BENCH_MAX_PACKETS) && (scenario.count > 0))
+    {
+        scenario.packets[scenario.count++].length = 0;
+    }
+}
+
+static void scenario_drop_empty(void)
+{
+    if((scenario.count > 0) && (scenario.packets[scenario.count - 1].length == 0))
+    {
+        scenario.count--;
+    }
+}
+
+/**
+ * @brief One command per USB packet, how most clients send
+ */
+static void build_single(void)
+{
+    scenario_begin("single");
+    for(uint32_t i = 0; i < 512; i++)
+    {
+        const char* command = command_mix[i % COMMAND_MIX_SIZE];
+
+        scenario_append((const uint8_t*)command, strlen(command), FAKE_USB_PACKET_SIZE);
+        scenario_packet_end();
+    }
+    scenario_drop_empty();
+}
+
+/**
+ * @brief Commands packed into full 64 byte packets
+ */
+static void build_burst(void)
+{
+    scenario_begin("burst");
+    for(uint32_t i = 0; i < 2048; i++)
+    {
+        const char* command = command_mix[i % COMMAND_MIX_SIZE];
+
+        scenario_append((const uint8_t*)command, strlen(command), FAKE_USB_PACKET_SIZE);
+    }
+}
+
+/**
+ * @brief Commands split over packets of 1 to 3 bytes
+ */
+static void build_split(void)
+{
+    scenario_begin("split");
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        const char* command = command_mix[i % COMMAND_MIX_SIZE];
+        uint32_t length = strlen(command);
+
+        for(uint32_t pos = 0; pos < length; )
+        {
+            uint32_t part = 1 + bench_random(3);
+
+            if(part > (length - pos))
+            {
+                part = length - pos;
+            }
+            scenario_append((const uint8_t*)&command[pos], part, FAKE_USB_PACKET_SIZE);
+            scenario_packet_end();
+            pos += part;
+        }
+    }
+    scenario_drop_empty();
+}
+
+/**
+ * @brief Line noise between the commands
+ */
+static void build_garbage(void)
+{
+    static const char noise[] = "abcxyz0123456789 \r\n*+-.";
+
+    scenario_begin("garbage");
+    for(uint32_t i = 0; i < 1024; i++)
+    {
+        const char* command = command_mix[i % COMMAND_MIX_SIZE];
+        uint32_t length = bench_random(12);
+
+        for(uint32_t n = 0; n < length; n++)
+        {
+            scenario_append((const uint8_t*)&noise[bench_random(sizeof(noise) - 1)], 1, FAKE_USB_PACKET_SIZE);
+        }
+        scenario_append((const uint8_t*)command, strlen(command), FAKE_USB_PACKET_SIZE);
+    }
+}
+
+/**
+ * @brief ACK bytes between the commands (Autostar alignment query)
+ */
+static void build_ack(void)
+{
+    static const uint8_t ack = BENCH_ACK;
+
+    scenario_begin("ack");
+    for(uint32_t i = 0; i < 1024; i++)
+    {
+        const char* command = command_mix[i % COMMAND_MIX_SIZE];
+
+        scenario_append(&ack, 1, FAKE_USB_PACKET_SIZE);
+        scenario_append((const uint8_t*)command, strlen(command), FAKE_USB_PACKET_SIZE);
+    }
+}
+
+static int hex_digit(char c)
+{
+    if((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    if((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Recorded traffic, one USB packet per line (see bench/traces)
+ * @retval 0 if the file can't be read
+ */
+static uint8_t build_trace(const char* path)
+{
+    char line[256];
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        fprintf(stderr, "lx200_bench: can't open %s\n", path);
+        return 0;
+    }
+
+    scenario_begin("trace");
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        uint8_t packet[FAKE_USB_PACKET_SIZE];
+        uint32_t length = 0;
+
+        if(strncmp(line, "//", 2) == 0)
+        {
+            continue;
+        }
+        for(char* p = line; (*p != '\0') && (*p != '\n') && (*p != '\r') && (length < sizeof(packet)); p++)
+        {
+            if((p[0] == '\\') && (p[1] == 'x') && (hex_digit(p[2]) >= 0) && (hex_digit(p[3]) >= 0))
+            {
+                packet[length++] = (uint8_t)(hex_digit(p[2]) * 16 + hex_digit(p[3]));
+                p += 3;
+            }
+            else if((p[0] == '\\') && (p[1] != '\0'))
+            {
+                packet[length++] = (p[1] == 'r') ? '\r' : (p[1] == 'n') ? '\n' : (uint8_t)p[1];
+                p++;
+            }
+            else
+            {
+                packet[length++] = (uint8_t)*p;
+            }
+        }
+        if(length > 0)
+        {
+            scenario_append(packet, length, FAKE_USB_PACKET_SIZE);
+            scenario_packet_end();
+        }
+    }
+    fclose(file);
+    scenario_drop_empty();
+    return scenario.count > 0;
+}
+
+/**
+ * @brief Mount state the command mix relies on: cached position, target and rate acknowledged
+ */
+static void bench_prepare(void)
+{
+    host_board_init();
+    fake_usb_receive(":RS#:Sr05:35:17#:Sd-05*23:28#");
+    host_board_run_ms(200);
+    fake_usb_receive(":GR#:GD#");
+    host_board_run_ms(100);
+    fake_usb_clear();
+    fake_uart_clear();
+    fake_debug_clear();
+}
+
+static result_t bench_run(uint32_t iterations)
+{
+    extern uint8_t USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len);
+    result_t result = {0};
+    uint32_t commands = GetLX200Stats()->commands;
+    uint32_t mount_bytes = mount_link_get_stats()->tx_bytes + mount_link_tx_depth();
+    uint32_t allocations_start = allocations;
+    uint64_t allocated_start = allocated_bytes;
+    uint64_t start = bench_now_ns();
+
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        for(uint32_t p = 0; p < scenario.count; p++)
+        {
+            USB_CDC_RxHandler(scenario.packets[p].data, scenario.packets[p].length);
+            ProcessLX200Queue();
+        }
+        fake_usb_clear();
+        fake_debug_clear();
+    }
+
+    result.ns = bench_now_ns() - start;
+    result.bytes = scenario.bytes * iterations;
+    result.commands = GetLX200Stats()->commands - commands;
+    result.mount_bytes = mount_link_get_stats()->tx_bytes + mount_link_tx_depth() - mount_bytes;
+    result.allocations = allocations - allocations_start;
+    result.allocated_bytes = allocated_bytes - allocated_start;
+    return result;
+}
+
+static void bench_report(FILE* out, const result_t* result, uint8_t first)
+{
+    double ns_per_byte = (result->bytes > 0) ? (double)result->ns / result->bytes : 0.0;
+    double ns_per_command = (result->commands > 0) ? (double)result->ns / result->commands : 0.0;
+    double commands_per_s = (result->ns > 0) ? result->commands * 1e9 / (double)result->ns : 0.0;
+
+    fprintf(out, "%s    {\"name\": \"%s\", \"packets\": %lu, \"bytes\": %lu, \"commands\": %lu, "
+                 "\"ns\": %llu, \"ns_per_byte\": %.2f, \"ns_per_command\": %.1f, \"commands_per_s\": %.0f, "
+                 "\"mount_bytes\": %lu, \"allocations\": %lu, \"allocated_bytes\": %llu}",
+            first ? "" : ",\n", scenario.name, (unsigned long)scenario.count, (unsigned long)result->bytes,
+            (unsigned long)result->commands, (unsigned long long)result->ns, ns_per_byte, ns_per_command,
+            commands_per_s, (unsigned long)result->mount_bytes, (unsigned long)result->allocations,
+            (unsigned long long)result->allocated_bytes);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: lx200_bench [--iterations N] [--scenario NAME] [--trace FILE] [--output FILE]\n"
+                    "scenarios: single burst split garbage ack trace\n");
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+int main(int argc, char** argv)
+{
+    static const struct {
+        const char* name;
+        void (*build)(void);
+    } builders[] = {
+        { "single",  build_single },
+        { "burst",   build_burst },
+        { "split",   build_split },
+        { "garbage", build_garbage },
+        { "ack",     build_ack },
+    };
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    const char* only = NULL;
+    const char* trace = LX200_BENCH_TRACE;
+    const char* output = NULL;
+    FILE* out = stdout;
+    uint8_t first = 1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--iterations") == 0) && (i + 1 < argc))
+        {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if((strcmp(argv[i], "--scenario") == 0) && (i + 1 < argc))
+        {
+            only = argv[++i];
+        }
+        else if((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+        {
+            trace = argv[++i];
+        }
+        else if((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if(output != NULL)
+    {
+        out = fopen(output, "w");
+        if(out == NULL)
+        {
+            fprintf(stderr, "lx200_bench: can't write %s\n", output);
+            return 1;
+        }
+    }
+
+    bench_prepare();
+
+    fprintf(out, "{\n  \"benchmark\": \"lx200_parser\",\n  \"iterations\": %lu,\n  \"results\": [\n",
+            (unsigned long)iterations);
+    for(size_t b = 0; b < sizeof(builders) / sizeof(builders[0]); b++)
+    {
+        if((only != NULL) && (strcmp(only, builders[b].name) != 0))
+        {
+            continue;
+        }
+        builders[b].build();
+        result_t result = bench_run(iterations);
+        bench_report(out, &result, first);
+        first = 0;
+    }
+    if(((only == NULL) || (strcmp(only, "trace") == 0)) && build_trace(trace))
+    {
+        result_t result = bench_run(iterations);
+        bench_report(out, &result, first);
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ ******************************************************************************
+ * @file    rewrite_bench.c
+ * @brief   Cost of the rewrite rules against the former hand coded correction (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * The former :Sr / :Sd correction is kept here as reference: it checked the
+ * space and copied the command in two strncpy() calls around the inserted
+ * character into a static buffer. The rules write the command once with
+ * lx200_rewrite_apply(), unchanged commands are not copied.
+ *
+ * Measured per command for a target without space, with space (nothing to
+ * insert) and a command only repeated (:MS#, not copied). The numbers
+ * are host nanoseconds, only the ratios carry over to the target.
+ *
+ * Usage: rewrite_bench [--iterations N] [--output FILE]
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lx200_rewrite.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define BENCH_DEFAULT_ITERATIONS 1000000
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    const char* name;
+    const char* command;
+    const lx200_rule_t* rule;
+} case_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static const lx200_rule_t rule_space = { LX200_RULE_INSERT, 3, 0, " ", 0 };
+static const lx200_rule_t rule_twice = { LX200_RULE_KEEP, 0, 0, NULL, 50 };
+
+static const case_t cases[] = {
+    { "insert",  ":Sr05:40:00#",  &rule_space },
+    { "present", ":Sr 05:40:00#", &rule_space },
+    { "keep",    ":MS#",          &rule_twice },
+};
+#define CASES   (sizeof(cases) / sizeof(cases[0]))
+
+static char corrected_command[64];
+/* keeps the compiler from dropping the work */
+static volatile uint32_t bench_sink = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief The former fs2_insert_space(), without the send
+ */
+static const char* legacy_correct(const char* command)
+{
+    if(command[3] == ' ')
+    {
+        return command;
+    }
+    strncpy(&corrected_command[0], &command[0], 3);
+    corrected_command[3] = ' ';
+    strncpy(&corrected_command[4], &command[3], sizeof(corrected_command) - 5);
+    corrected_command[sizeof(corrected_command) - 1] = '\0';
+    return corrected_command;
+}
+
+static double bench_legacy(const char* command, uint32_t iterations)
+{
+    uint64_t start = bench_now_ns();
+
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        bench_sink += (uint8_t)legacy_correct(command)[4];
+    }
+    return (double)(bench_now_ns() - start) / iterations;
+}
+
+static double bench_rule(const case_t* c, uint32_t iterations)
+{
+    char out[LX200_REWRITE_MAX_LEN];
+    uint64_t start = bench_now_ns();
+
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        bench_sink += (uint8_t)lx200_rewrite_apply(c->rule, c->command, out, sizeof(out))[4];
+    }
+    return (double)(bench_now_ns() - start) / iterations;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: rewrite_bench [--iterations N] [--output FILE]\n");
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    const char* output = NULL;
+    FILE* out = stdout;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--iterations") == 0) && (i + 1 < argc))
+        {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if(iterations == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    if(output != NULL)
+    {
+        out = fopen(output, "w");
+        if(out == NULL)
+        {
+            fprintf(stderr, "rewrite_bench: can't write %s\n", output);
+            return 1;
+        }
+    }
+
+    fprintf(out, "{\n  \"benchmark\": \"rewrite_rules\",\n  \"iterations\": %lu,\n  \"results\": [\n",
+            (unsigned long)iterations);
+    for(uint32_t i = 0; i < CASES; i++)
+    {
+        // the former code had no rule for commands only repeated, they were sent as they are
+        double legacy_ns = (cases[i].rule == &rule_space) ? bench_legacy(cases[i].command, iterations) : 0.0;
+
+        fprintf(out, "%s    {\"name\": \"%s\", \"command\": \"%s\", \"legacy_ns\": %.1f, \"rule_ns\": %.1f}",
+                (i == 0) ? "" : ",\n", cases[i].name, cases[i].command, legacy_ns,
+                bench_rule(&cases[i], iterations));
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ ******************************************************************************
+ * @file    st4_bench.c
+ * @brief   Cost of the ST4 axis engine against the former polled handler (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * The former handler is kept here as reference: st4_process() was called
+ * every main loop pass, read HAL_GetTick() once per direction and switched
+ * each pin with its own HAL_GPIO_WritePin(). The axis engine costs one
+ * st4_commit() per pass, edges are written with one BSRR access each.
+ *
+ * Measured per pass without pulses (idle), per RA + Dec correction start
+ * (two pulses and the pass switching them on) and per correction end. The
+ * ends of the engine run in the TIM2 interrupt inside fake_hal_advance_us(),
+ * their cost is the advance with pulses ending minus an idle advance.
+ * The numbers are host nanoseconds, only the ratios carry over to the target.
+ *
+ * Usage: st4_bench [--iterations N] [--output FILE]
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "main.h"
+#include "fake_hal.h"
+#include "host_board.h"
+#include "st4_handler.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define BENCH_DEFAULT_ITERATIONS 200000
+#define BENCH_PULSE_MS          1
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    volatile uint8_t active;
+    volatile int32_t off_ticktime;
+} legacy_pin_t;
+
+typedef struct {
+    double idle_ns;
+    double start_ns;
+    double end_ns;
+    double writes_per_correction;
+} result_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static legacy_pin_t legacy_north, legacy_south, legacy_east, legacy_west;
+static uint32_t legacy_writes = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void legacy_write(uint16_t pin, GPIO_PinState state)
+{
+    HAL_GPIO_WritePin(ST4_PORT, pin, state);
+    legacy_writes++;
+}
+
+static void legacy_set(legacy_pin_t* pin, uint32_t duration_ms)
+{
+    pin->off_ticktime = HAL_GetTick() + duration_ms;
+}
+
+/**
+ * @brief One direction of the former st4_process(), the function repeated it four times
+ */
+static void legacy_direction(legacy_pin_t* pin, uint16_t gpio)
+{
+    int32_t remaining_ticks = (int32_t)(pin->off_ticktime - HAL_GetTick());
+
+    if((!pin->active) && (remaining_ticks > 0))
+    {
+        pin->active = 1;
+        legacy_write(gpio, GPIO_PIN_RESET);
+    }
+    else if((pin->active) && (remaining_ticks <= 0))
+    {
+        pin->active = 0;
+        legacy_write(gpio, GPIO_PIN_SET);
+    }
+}
+
+static void legacy_process(void)
+{
+    legacy_direction(&legacy_north, ST4_NORTH_Pin);
+    legacy_direction(&legacy_south, ST4_SOUTH_Pin);
+    legacy_direction(&legacy_east, ST4_EAST_Pin);
+    legacy_direction(&legacy_west, ST4_WEST_Pin);
+}
+
+static result_t bench_legacy(uint32_t iterations)
+{
+    result_t result = {0};
+    uint64_t start;
+    uint64_t start_ns = 0;
+    uint64_t end_ns = 0;
+
+    start = bench_now_ns();
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        legacy_process();
+    }
+    result.idle_ns = (double)(bench_now_ns() - start) / iterations;
+
+    legacy_writes = 0;
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        start = bench_now_ns();
+        legacy_set(&legacy_north, BENCH_PULSE_MS);
+        legacy_set(&legacy_west, BENCH_PULSE_MS);
+        legacy_process();
+        start_ns += bench_now_ns() - start;
+
+        fake_hal_advance_us(BENCH_PULSE_MS * 1000U);
+
+        start = bench_now_ns();
+        legacy_process();
+        end_ns += bench_now_ns() - start;
+    }
+    result.start_ns = (double)start_ns / iterations;
+    result.end_ns = (double)end_ns / iterations;
+    result.writes_per_correction = (double)legacy_writes / iterations;
+    return result;
+}
+
+static result_t bench_engine(uint32_t iterations)
+{
+    result_t result = {0};
+    uint64_t start;
+    uint64_t start_ns = 0;
+    uint64_t advance_ns = 0;
+    uint64_t idle_advance_ns = 0;
+
+    start = bench_now_ns();
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        st4_commit();
+    }
+    result.idle_ns = (double)(bench_now_ns() - start) / iterations;
+
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        start = bench_now_ns();
+        st4_set(ST4_NORTH, BENCH_PULSE_MS);
+        st4_set(ST4_WEST, BENCH_PULSE_MS);
+        st4_commit();
+        start_ns += bench_now_ns() - start;
+
+        start = bench_now_ns();
+        fake_hal_advance_us(BENCH_PULSE_MS * 1000U);
+        advance_ns += bench_now_ns() - start;
+
+        start = bench_now_ns();
+        fake_hal_advance_us(BENCH_PULSE_MS * 1000U);
+        idle_advance_ns += bench_now_ns() - start;
+    }
+    result.start_ns = (double)start_ns / iterations;
+    result.end_ns = ((double)advance_ns - (double)idle_advance_ns) / iterations;
+    // one BSRR write switches both on, the ends share one compare interrupt
+    result.writes_per_correction = 2.0;
+    return result;
+}
+
+static void bench_report(FILE* out, const char* name, const result_t* result, uint8_t first)
+{
+    fprintf(out, "%s    {\"name\": \"%s\", \"idle_ns_per_pass\": %.1f, \"start_ns\": %.1f, "
+                 "\"end_ns\": %.1f, \"gpio_writes_per_correction\": %.1f}",
+            first ? "" : ",\n", name, result->idle_ns, result->start_ns, result->end_ns,
+            result->writes_per_correction);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: st4_bench [--iterations N] [--output FILE]\n");
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    const char* output = NULL;
+    FILE* out = stdout;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--iterations") == 0) && (i + 1 < argc))
+        {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if(iterations == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    if(output != NULL)
+    {
+        out = fopen(output, "w");
+        if(out == NULL)
+        {
+            fprintf(stderr, "st4_bench: can't write %s\n", output);
+            return 1;
+        }
+    }
+
+    host_board_init();
+
+    result_t legacy = bench_legacy(iterations);
+    result_t engine = bench_engine(iterations);
+
+    fprintf(out, "{\n  \"benchmark\": \"st4_engine\",\n  \"iterations\": %lu,\n  \"results\": [\n",
+            (unsigned long)iterations);
+    bench_report(out, "polled", &legacy, 1);
+    bench_report(out, "axis_engine", &engine, 0);
+    fprintf(out, "\n  ]\n}\n");
+
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ ******************************************************************************
+ * @file    usb_isr_bench.c
+ * @brief   USB receive interrupt: former command processing against the queue copy (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * The former interrupt handler is kept here as reference: CDC_Receive_FS()
+ * parsed the packet and ran ProcessLX200Command_FS2() for every command in
+ * the interrupt. Each command was echoed on the debug UART and sent to the
+ * mount with the blocking UART_Printf() (HAL_UART_Transmit() with
+ * HAL_MAX_DELAY), :MS# and :Q# waited in a busy loop of 50 * 18000
+ * iterations between their two sends.
+ *
+ * The host HAL returns from HAL_UART_Transmit() at once and code takes no
+ * virtual time, so the reference charges its blocking waits to the DWT
+ * stand-in: 10 bit times per byte at the baud rate of the UART and 4 cycles
+ * per busy loop iteration (the 18000 iterations per ms the loop was written
+ * for, at 72 MHz). The current handler (USB_CDC_RxHandler() of host_board.c,
+ * the code of the interrupt) has no blocking call. Both are measured per USB
+ * packet in DWT cycles (us at 72 MHz) and in host nanoseconds, which only
+ * carry over to the target as ratio.
+ *
+ * Usage: usb_isr_bench [--iterations N] [--output FILE]
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include "main.h"
+#include "fake_hal.h"
+#include "host_board.h"
+#include "perf_counter.h"
+#include "st4_handler.h"
+#include "usbd_cdc_if.h"
+
+extern uint8_t USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len);
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define BENCH_DEFAULT_ITERATIONS 200
+/* former busy loop between the two sends of :MS# / :Q# */
+#define LEGACY_BUSY_ITERATIONS  (50 * 18000)
+#define LEGACY_CYCLES_PER_ITERATION 4
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    const char* name;
+    const char* packet;
+} bench_packet_t;
+
+typedef struct {
+    uint32_t max_cycles;
+    double mean_ns;
+    double max_ns;
+} result_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static const bench_packet_t packets[] = {
+    { "get_ra",       ":GR#" },
+    { "position",     ":GR#:GD#" },
+    { "set_target",   ":Sr05:40:00#" },
+    { "goto",         ":MS#" },
+    { "guide",        ":Mgn0100#" },
+};
+#define BENCH_PACKETS   (sizeof(packets) / sizeof(packets[0]))
+
+static char legacy_buffer[64];
+static uint8_t legacy_started = 0;
+static uint8_t legacy_index = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Former UART_Printf(), HAL_UART_Transmit() waited until the last byte was sent
+ */
+static void legacy_printf(UART_HandleTypeDef* huart, const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if((len > 0) && (len < (int)sizeof(buffer)))
+    {
+        fake_hal_advance_us((uint32_t)((uint64_t)len * 10U * 1000000U / huart->Init.BaudRate));
+    }
+}
+
+static void legacy_busy_loop(void)
+{
+    uint64_t cycles = (uint64_t)LEGACY_BUSY_ITERATIONS * LEGACY_CYCLES_PER_ITERATION;
+
+    fake_hal_advance_us((uint32_t)(cycles / (SystemCoreClock / 1000000U)));
+}
+
+/**
+ * @brief Former ProcessLX200Command_FS2(), the branches of the bench packets
+ */
+static void legacy_command(const char* command)
+{
+    char corrected[sizeof(legacy_buffer) + 2];
+
+    legacy_printf(UART_DEBUG, "%s\r\n", command);
+
+    if((strncmp(command, ":Sr", 3) == 0) || (strncmp(command, ":Sd", 3) == 0))
+    {
+        snprintf(corrected, sizeof(corrected), "%.3s %s", command, &command[3]);
+        legacy_printf(UART_DEBUG, "-> space inserted, corrected: %s\r\n", corrected);
+        legacy_printf(UART_OUT, "%s", corrected);
+    }
+    else if((strcmp(command, ":MS#") == 0) || (strcmp(command, ":Q#") == 0))
+    {
+        legacy_printf(UART_OUT, "%s", command);
+        legacy_printf(UART_DEBUG, "-> FS2 BUGFIX, send %s two times\r\n", command);
+        legacy_busy_loop();
+        legacy_printf(UART_OUT, "%s", command);
+    }
+    else if(strncmp(command, ":Mgn", 4) == 0)
+    {
+        st4_set(ST4_NORTH, st4_parse_duration(command));
+    }
+    else
+    {
+        legacy_printf(UART_OUT, "%s", command);
+        legacy_printf(UART_DEBUG, "-> send to FS2\r\n");
+    }
+}
+
+/**
+ * @brief Former CDC_Receive_FS() -> ParseLX200Data(), ran in the USB interrupt
+ */
+static void legacy_isr(const uint8_t* data, uint32_t length)
+{
+    for(uint32_t i = 0; i < length; i++)
+    {
+        char c = (char)data[i];
+
+        if(legacy_started)
+        {
+            if(legacy_index < sizeof(legacy_buffer) - 1)
+            {
+                legacy_buffer[legacy_index++] = c;
+                if(c == '#')
+                {
+                    legacy_buffer[legacy_index] = '\0';
+                    legacy_command(legacy_buffer);
+                    legacy_started = 0;
+                    legacy_index = 0;
+                }
+            }
+            else
+            {
+                legacy_started = 0;
+                legacy_index = 0;
+            }
+        }
+        else if(c == ':')
+        {
+            legacy_started = 1;
+            legacy_index = 0;
+            legacy_buffer[legacy_index++] = c;
+        }
+    }
+}
+
+static result_t bench_packet(const bench_packet_t* packet, uint32_t iterations, uint8_t legacy)
+{
+    result_t result = {0};
+    uint8_t data[64];
+    uint32_t length = (uint32_t)strlen(packet->packet);
+    uint64_t sum_ns = 0;
+
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        // the interrupt overwrites nothing of the packet in the former code, copy for both
+        memcpy(data, packet->packet, length);
+
+        uint32_t start = perf_cycles();
+        uint64_t start_ns = bench_now_ns();
+
+        if(legacy)
+        {
+            legacy_isr(data, length);
+        }
+        else
+        {
+            USB_CDC_RxHandler(data, length);
+        }
+
+        uint64_t ns = bench_now_ns() - start_ns;
+        uint32_t cycles = perf_cycles() - start;
+
+        sum_ns += ns;
+        if((double)ns > result.max_ns)
+        {
+            result.max_ns = (double)ns;
+        }
+        if(cycles > result.max_cycles)
+        {
+            result.max_cycles = cycles;
+        }
+
+        // main loop handles the packet, guide pulses end, mount replies arrive
+        host_board_run_ms(200);
+    }
+    result.mean_ns = (double)sum_ns / iterations;
+    return result;
+}
+
+static void bench_report(FILE* out, const char* name, const char* handler, const result_t* result, uint8_t first)
+{
+    fprintf(out, "%s    {\"packet\": \"%s\", \"handler\": \"%s\", \"isr_max_us\": %lu, "
+                 "\"host_mean_ns\": %.1f, \"host_max_ns\": %.1f}",
+            first ? "" : ",\n", name, handler, (unsigned long)PERF_CYCLES_TO_US(result->max_cycles),
+            result->mean_ns, result->max_ns);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: usb_isr_bench [--iterations N] [--output FILE]\n");
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+int main(int argc, char** argv)
+{
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    const char* output = NULL;
+    FILE* out = stdout;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--iterations") == 0) && (i + 1 < argc))
+        {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if(iterations == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    if(output != NULL)
+    {
+        out = fopen(output, "w");
+        if(out == NULL)
+        {
+            fprintf(stderr, "usb_isr_bench: can't write %s\n", output);
+            return 1;
+        }
+    }
+
+    host_board_init();
+
+    fprintf(out, "{\n  \"benchmark\": \"usb_isr\",\n  \"iterations\": %lu,\n  \"results\": [\n",
+            (unsigned long)iterations);
+    for(uint8_t p = 0; p < BENCH_PACKETS; p++)
+    {
+        result_t legacy = bench_packet(&packets[p], iterations, 1);
+        result_t queue = bench_packet(&packets[p], iterations, 0);
+
+        bench_report(out, packets[p].name, "in_isr", &legacy, p == 0);
+        bench_report(out, packets[p].name, "queue", &queue, 0);
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ ******************************************************************************
+ * @file    fake_fs2.h
+ * @brief   Header for the scripted FS2 mount on the fake mount UART
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef FAKE_FS2_H
+#define FAKE_FS2_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* reply time of the mount firmware, after the last command byte was received */
+#define FAKE_FS2_REPLY_US       5000
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void fake_fs2_init(void);
+void fake_fs2_process(void);
+void fake_fs2_set_silent(uint8_t on);
+void fake_fs2_set_ignored(const char* command);
+uint32_t fake_fs2_count(const char* prefix);
+void fake_fs2_clear_counts(void);
+
+#endif // FAKE_FS2_H
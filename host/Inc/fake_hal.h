@@ -0,0 +1,71 @@
+/*
+ ******************************************************************************
+ * @file    fake_hal.h
+ * @brief   Control of the fake HAL: virtual time, USB and UART data (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef FAKE_HAL_H
+#define FAKE_HAL_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* captured output per interface, the oldest half is dropped when full */
+#define FAKE_CAPTURE_SIZE       4096
+/* USB full speed bulk packet */
+#define FAKE_USB_PACKET_SIZE    64
+/* the two configuration pages (config_store.c) */
+#define FAKE_FLASH_SIZE         2048
+/* core stall per halfword and per page erase, typical values of the datasheet */
+#define FAKE_FLASH_PROGRAM_US   52
+#define FAKE_FLASH_ERASE_US     20000
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+/* called with data leaving the proxy: USB transmits, mount UART transfers once sent */
+typedef void (*fake_listener_t)(const uint8_t* data, uint16_t length);
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+/* virtual time, runs the mount UART DMA completions that fall into the interval */
+void fake_hal_advance_us(uint32_t us);
+uint64_t fake_hal_time_us(void);
+
+/* USB: host -> proxy in packets, proxy -> host captured */
+void fake_usb_receive(const char* data);
+void fake_usb_receive_bytes(const uint8_t* data, uint32_t length);
+uint32_t fake_usb_pending(void);
+void fake_usb_set_busy(uint8_t busy);
+const char* fake_usb_output(void);
+void fake_usb_clear(void);
+void fake_usb_set_listener(fake_listener_t listener);
+
+/* mount UART: mount -> proxy via the DMA buffer, proxy -> mount captured when sent */
+void fake_uart_receive(const char* data);
+void fake_uart_receive_bytes(const uint8_t* data, uint32_t length);
+void fake_uart_error(uint32_t error);
+const char* fake_uart_output(void);
+void fake_uart_clear(void);
+void fake_uart_set_listener(fake_listener_t listener);
+
+/* debug UART, also printed on stderr if LX200_HOST_VERBOSE is set */
+const char* fake_debug_output(void);
+void fake_debug_clear(void);
+
+/* configuration flash */
+void fake_flash_reset(void);
+void fake_flash_cut_after(uint32_t count);
+uint32_t fake_flash_erase_count(void);
+
+#endif // FAKE_HAL_H
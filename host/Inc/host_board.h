@@ -0,0 +1,27 @@
+/*
+ ******************************************************************************
+ * @file    host_board.h
+ * @brief   Header for the host replacement of main.c
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void host_board_init(void);
+void host_board_loop(void);
+uint32_t host_board_next_ms(void);
+void host_board_run_ms(uint32_t ms);
+
+#endif // HOST_BOARD_H
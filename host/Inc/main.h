@@ -0,0 +1,59 @@
+/*
+ ******************************************************************************
+ * @file    main.h
+ * @brief   Common defines of the application (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Replaces Core/Inc/main.h, keep the application part in sync with it.
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include "stm32f1xx_hal.h"
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+#define ENABLE_DEBUG_PRINTF 0
+
+/* Debug output macros */
+#if ENABLE_DEBUG_PRINTF >= 1
+    #define DEBUG_PRINTF(...) UART_Printf( __VA_ARGS__)
+#else
+    #define DEBUG_PRINTF(...)
+#endif
+
+#define LED_Pin GPIO_PIN_13
+#define LED_GPIO_Port GPIOC
+#define ST4_EAST_Pin GPIO_PIN_12
+#define ST4_EAST_GPIO_Port GPIOB
+#define ST4_NORTH_Pin GPIO_PIN_13
+#define ST4_NORTH_GPIO_Port GPIOB
+#define ST4_SOUTH_Pin GPIO_PIN_14
+#define ST4_SOUTH_GPIO_Port GPIOB
+#define ST4_WEST_Pin GPIO_PIN_15
+#define ST4_WEST_GPIO_Port GPIOB
+
+#define ST4_PORT                GPIOB
+
+// UART Defines for easier usage
+extern UART_HandleTypeDef huart1;
+extern UART_HandleTypeDef huart2;
+extern UART_HandleTypeDef huart3;
+#define UART_DEBUG &huart1  // UART3 for debug output
+#define UART_OUT &huart2    // UART2 for normal output
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void Error_Handler(void);
+void UART_Printf(UART_HandleTypeDef *huart, const char *format, ...);
+
+#endif /* __MAIN_H */
@@ -0,0 +1,219 @@
+/*
+ ******************************************************************************
+ * @file    stm32f1xx_hal.h
+ * @brief   Fake of the HAL subset used by the application (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Only the types, registers and functions the application modules use.
+ * Time is virtual: HAL_GetTick() and the DWT cycle counter advance with
+ * fake_hal_advance_us() (see fake_hal.h), never by themselves. TIM2 counts
+ * on the same time base and raises its compare interrupts from there.
+ */
+
+#ifndef STM32F1XX_HAL_H
+#define STM32F1XX_HAL_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+#include <stddef.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+#define HAL_MAX_DELAY           0xFFFFFFFFU
+
+#define GPIO_PIN_12             ((uint16_t)0x1000)
+#define GPIO_PIN_13             ((uint16_t)0x2000)
+#define GPIO_PIN_14             ((uint16_t)0x4000)
+#define GPIO_PIN_15             ((uint16_t)0x8000)
+
+#define HAL_UART_ERROR_NONE     0x00000000U
+#define HAL_UART_ERROR_PE       0x00000001U
+#define HAL_UART_ERROR_NE       0x00000002U
+#define HAL_UART_ERROR_FE       0x00000004U
+#define HAL_UART_ERROR_ORE      0x00000008U
+
+#define TIM_CR1_CEN             (1UL << 0)
+#define TIM_DIER_CC1IE          (1UL << 1)
+#define TIM_SR_CC1IF            (1UL << 1)
+#define TIM_EGR_UG              (1UL << 0)
+
+#define __HAL_RCC_TIM2_CLK_ENABLE()     do { } while(0)
+
+#define FLASH_PAGE_SIZE             0x400U
+#define FLASH_TYPEPROGRAM_HALFWORD  0x01U
+#define FLASH_TYPEERASE_PAGES       0x00U
+#define FLASH_BANK_1                1U
+
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    volatile uint32_t CRL;
+    volatile uint32_t CRH;
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint32_t BSRR;
+    volatile uint32_t BRR;
+    volatile uint32_t LCKR;
+} GPIO_TypeDef;
+
+typedef struct {
+    uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct {
+    UART_InitTypeDef Init;
+    volatile uint32_t ErrorCode;
+} UART_HandleTypeDef;
+
+typedef enum {
+    USB_LP_CAN1_RX0_IRQn = 20,
+    TIM2_IRQn = 28
+} IRQn_Type;
+
+/* general purpose timer, registers up to CCR4 in the order of the device header */
+typedef struct {
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t SMCR;
+    volatile uint32_t DIER;
+    volatile uint32_t SR;
+    volatile uint32_t EGR;
+    volatile uint32_t CCMR1;
+    volatile uint32_t CCMR2;
+    volatile uint32_t CCER;
+    volatile uint32_t CNT;
+    volatile uint32_t PSC;
+    volatile uint32_t ARR;
+    volatile uint32_t RCR;
+    volatile uint32_t CCR1;
+    volatile uint32_t CCR2;
+    volatile uint32_t CCR3;
+    volatile uint32_t CCR4;
+} TIM_TypeDef;
+
+/* PageAddress is uint32_t on the target, the fake flash is in host memory */
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uintptr_t PageAddress;
+    uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+/* ============================================================================
+ *                         PUBLIC VARIABLES
+ * ============================================================================ */
+extern GPIO_TypeDef fake_gpiob;
+extern GPIO_TypeDef fake_gpioc;
+extern TIM_TypeDef fake_tim2;
+extern CoreDebug_Type fake_core_debug;
+extern DWT_Type fake_dwt;
+extern uint32_t SystemCoreClock;
+
+#define GPIOB                   (&fake_gpiob)
+#define GPIOC                   (&fake_gpioc)
+#define TIM2                    (&fake_tim2)
+#define CoreDebug               (&fake_core_debug)
+#define DWT                     (&fake_dwt)
+
+/* configuration pages of config_store.c, see fake_hal.h */
+extern uint8_t fake_flash[];
+#define CONFIG_FLASH_ADDRESS    ((uintptr_t)fake_flash)
+
+/* ============================================================================
+ *                         CMSIS INTRINSICS
+ * ============================================================================ */
+static inline uint32_t __CLZ(uint32_t value)
+{
+    return (value == 0) ? 32U : (uint32_t)__builtin_clz(value);
+}
+
+static inline void __DMB(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* single threaded: "interrupts" only run from fake_hal_advance_us() */
+static inline uint32_t __get_PRIMASK(void)
+{
+    return 0;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+    (void)primask;
+}
+
+static inline void __disable_irq(void)
+{
+}
+
+static inline void __enable_irq(void)
+{
+}
+
+/* the host never sleeps, host_board_run_ms() advances the time between passes */
+static inline void __WFI(void)
+{
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size);
+uint32_t HAL_UART_GetError(UART_HandleTypeDef* huart);
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* PageError);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+
+/* application callbacks, implemented by the board file */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef* huart, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef* huart);
+void TIM2_IRQHandler(void);
+
+#endif // STM32F1XX_HAL_H
@@ -0,0 +1,47 @@
+/*
+ ******************************************************************************
+ * @file    usbd_cdc_if.h
+ * @brief   Fake of the USB CDC interface (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Transmitted data is collected by the fake HAL, see fake_usb_output().
+ */
+
+#ifndef __USBD_CDC_IF_H__
+#define __USBD_CDC_IF_H__
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+#define USBD_OK     0U
+#define USBD_BUSY   1U
+#define USBD_FAIL   3U
+
+/* ============================================================================
+ *                         PUBLIC TYPES
+ * ============================================================================ */
+/** Counters of the USB TX ring buffer */
+typedef struct
+{
+  uint32_t queued;      /* bytes accepted by CDC_Transmit_FS */
+  uint32_t coalesced;   /* bytes queued while a transfer was in flight */
+  uint32_t dropped;     /* bytes rejected because the ring buffer was full */
+  uint32_t transfers;   /* IN transfers started */
+} CDC_TxStatsTypeDef;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);
+const CDC_TxStatsTypeDef* CDC_GetTxStats_FS(void);
+void CDC_ResumeReceive_FS(void);
+
+#endif /* __USBD_CDC_IF_H__ */
@@ -0,0 +1,202 @@
+/*
+ ******************************************************************************
+ * @file    fake_fs2.c
+ * @brief   Scripted FS2 mount on the fake mount UART
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Receives the commands leaving the mount UART and answers them after
+ * FAKE_FS2_REPLY_US like the FS2 controller does. The position only changes
+ * with :MS# (jumps to the target), enough to check the proxy, not the mount.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <string.h>
+#include "fake_hal.h"
+#include "fake_fs2.h"
+
+/* ============================================================================
+ *                         PRIVATE DEFINES
+ * ============================================================================ */
+#define FS2_COMMAND_SIZE    32
+#define FS2_REPLY_SIZE      64
+#define FS2_LOG_SIZE        64
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static char command[FS2_COMMAND_SIZE];
+static uint8_t command_length = 0;
+
+static char reply[FS2_REPLY_SIZE];
+static uint64_t reply_due_us = 0;
+
+static char position_ra[16] = "05:35:17";
+static char position_dec[16] = "-05*23:28";
+static char target_ra[16] = "05:35:17";
+static char target_dec[16] = "-05*23:28";
+
+static uint8_t silent = 0;
+/* command the mount does not know, NULL if all are answered */
+static const char* ignored = NULL;
+
+/* commands received, for fake_fs2_count() */
+static char command_log[FS2_LOG_SIZE][FS2_COMMAND_SIZE];
+static uint32_t command_log_count = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static void fs2_reply(const char* text)
+{
+    size_t used = strlen(reply);
+
+    snprintf(&reply[used], sizeof(reply) - used, "%s", text);
+    reply_due_us = fake_hal_time_us() + FAKE_FS2_REPLY_US;
+}
+
+/**
+ * @brief Copy the coordinate of a :Sr / :Sd command (space inserted by the proxy)
+ */
+static void fs2_copy_value(char* out, const char* value)
+{
+    while(*value == ' ')
+    {
+        value++;
+    }
+    snprintf(out, 16, "%.*s", (int)strcspn(value, "#"), value);
+}
+
+static void fs2_execute(const char* cmd)
+{
+    char text[FS2_REPLY_SIZE];
+
+    if(command_log_count < FS2_LOG_SIZE)
+    {
+        snprintf(command_log[command_log_count++], FS2_COMMAND_SIZE, "%s", cmd);
+    }
+    if(silent || ((ignored != NULL) && (strcmp(cmd, ignored) == 0)))
+    {
+        return;
+    }
+
+    if(strcmp(cmd, ":GR#") == 0)
+    {
+        snprintf(text, sizeof(text), "%s#", position_ra);
+        fs2_reply(text);
+    }
+    else if(strcmp(cmd, ":GD#") == 0)
+    {
+        snprintf(text, sizeof(text), "%s#", position_dec);
+        fs2_reply(text);
+    }
+    else if(strncmp(cmd, ":Sr", 3) == 0)
+    {
+        fs2_copy_value(target_ra, &cmd[3]);
+        fs2_reply("1");
+    }
+    else if(strncmp(cmd, ":Sd", 3) == 0)
+    {
+        fs2_copy_value(target_dec, &cmd[3]);
+        fs2_reply("1");
+    }
+    else if(strcmp(cmd, ":MS#") == 0)
+    {
+        strcpy(position_ra, target_ra);
+        strcpy(position_dec, target_dec);
+        fs2_reply("0");
+    }
+    else if(strcmp(cmd, ":CM#") == 0)
+    {
+        fs2_reply("Coordinates matched.#");
+    }
+    else if(strcmp(cmd, ":D#") == 0)
+    {
+        fs2_reply("#");
+    }
+}
+
+static void fs2_receive(const uint8_t* data, uint16_t length)
+{
+    for(uint16_t i = 0; i < length; i++)
+    {
+        if((command_length == 0) && (data[i] != ':'))
+        {
+            continue;   // not inside a command, the coordinates contain ':' too
+        }
+        if(command_length < (FS2_COMMAND_SIZE - 1))
+        {
+            command[command_length++] = (char)data[i];
+        }
+        if(data[i] == '#')
+        {
+            command[command_length] = '\0';
+            fs2_execute(command);
+            command_length = 0;
+        }
+    }
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void fake_fs2_init(void)
+{
+    fake_uart_set_listener(fs2_receive);
+}
+
+/**
+ * @brief Send the reply when it is due (call with the main loop)
+ */
+void fake_fs2_process(void)
+{
+    if((reply[0] != '\0') && (fake_hal_time_us() >= reply_due_us))
+    {
+        fake_uart_receive(reply);
+        reply[0] = '\0';
+    }
+}
+
+/**
+ * @brief Mount stops answering (commands are still counted)
+ */
+void fake_fs2_set_silent(uint8_t on)
+{
+    silent = on;
+}
+
+/**
+ * @brief Mount firmware without this command, it gets no reply (NULL: all answered)
+ */
+void fake_fs2_set_ignored(const char* command)
+{
+    ignored = command;
+}
+
+/**
+ * @brief Number of received commands starting with prefix
+ */
+uint32_t fake_fs2_count(const char* prefix)
+{
+    uint32_t count = 0;
+
+    for(uint32_t i = 0; i < command_log_count; i++)
+    {
+        if(strncmp(command_log[i], prefix, strlen(prefix)) == 0)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void fake_fs2_clear_counts(void)
+{
+    command_log_count = 0;
+}
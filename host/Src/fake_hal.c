@@ -0,0 +1,608 @@
+/*
+ ******************************************************************************
+ * @file    fake_hal.c
+ * @brief   Fake of the HAL subset used by the application (host build)
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Virtual time is kept in core clock cycles, HAL_GetTick() and DWT->CYCCNT
+ * are derived from it. Interrupts are simulated synchronously: mount UART
+ * transfer completions and TIM2 compare matches run from fake_hal_advance_us()
+ * at their time, receptions from fake_uart_receive() and USB
+ * packets from fake_usb_receive() / CDC_ResumeReceive_FS().
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "usbd_cdc_if.h"
+#include "fake_hal.h"
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    char data[FAKE_CAPTURE_SIZE];
+    uint32_t length;
+} capture_t;
+
+/* ============================================================================
+ *                         PUBLIC VARIABLES
+ * ============================================================================ */
+GPIO_TypeDef fake_gpiob;
+GPIO_TypeDef fake_gpioc;
+TIM_TypeDef fake_tim2;
+CoreDebug_Type fake_core_debug;
+DWT_Type fake_dwt;
+uint32_t SystemCoreClock = 72000000;
+
+uint8_t fake_flash[FAKE_FLASH_SIZE];
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static uint64_t now_cycles = 0;
+
+/* TIM2 counter: cycles at counter value 0, set when the counter is enabled */
+static uint8_t tim2_running = 0;
+static uint64_t tim2_origin = 0;
+
+/* mount UART (huart2) DMA */
+static uint8_t* rx_dma_buffer = NULL;
+static uint16_t rx_dma_size = 0;
+static uint16_t rx_dma_pos = 0;
+static const uint8_t* tx_dma_data = NULL;
+static uint16_t tx_dma_length = 0;
+static uint64_t tx_dma_done = 0;
+static fake_listener_t uart_listener = NULL;
+
+/* USB packets not accepted yet (endpoint paused) */
+static char usb_pending[FAKE_CAPTURE_SIZE];
+static uint32_t usb_pending_length = 0;
+static uint8_t usb_paused = 0;
+static uint8_t usb_busy = 0;
+static CDC_TxStatsTypeDef cdc_stats;
+static fake_listener_t usb_listener = NULL;
+
+/* configuration pages, NOR semantics: programming only clears bits */
+static uint8_t flash_locked = 1;
+static uint32_t flash_cut = UINT32_MAX;
+static uint32_t flash_erases = 0;
+
+static capture_t usb_capture;
+static capture_t uart_capture;
+static capture_t debug_capture;
+static int debug_verbose = -1;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static void capture_append(capture_t* capture, const uint8_t* data, uint32_t length)
+{
+    if(length >= sizeof(capture->data))
+    {
+        data += length - (sizeof(capture->data) - 1);
+        length = sizeof(capture->data) - 1;
+    }
+    if((capture->length + length) >= sizeof(capture->data))
+    {
+        // keep the newer half
+        uint32_t keep = capture->length / 2;
+        memmove(capture->data, &capture->data[capture->length - keep], keep);
+        capture->length = keep;
+        if((capture->length + length) >= sizeof(capture->data))
+        {
+            capture->length = 0;
+        }
+    }
+    memcpy(&capture->data[capture->length], data, length);
+    capture->length += length;
+    capture->data[capture->length] = '\0';
+}
+
+static void capture_clear(capture_t* capture)
+{
+    capture->length = 0;
+    capture->data[0] = '\0';
+}
+
+static uint64_t tim2_ticks(uint64_t cycles)
+{
+    return (cycles - tim2_origin) / (fake_tim2.PSC + 1U);
+}
+
+static void tim2_update(void)
+{
+    if(!(fake_tim2.CR1 & TIM_CR1_CEN))
+    {
+        tim2_running = 0;
+        return;
+    }
+    if(!tim2_running)
+    {
+        tim2_running = 1;
+        tim2_origin = now_cycles;
+        fake_tim2.CNT = 0;
+    }
+    fake_tim2.CNT = (uint32_t)(tim2_ticks(now_cycles) % (fake_tim2.ARR + 1U));
+}
+
+/**
+ * @brief Time of the next enabled TIM2 compare match
+ * @param flags: TIM_SR_CCxIF of all channels matching at that time
+ * @retval cycles, UINT64_MAX if none
+ */
+static uint64_t tim2_next_event(uint32_t* flags)
+{
+    uint64_t next = UINT64_MAX;
+
+    tim2_update();
+    if(!tim2_running)
+    {
+        return next;
+    }
+
+    uint64_t now_tick = tim2_ticks(now_cycles);
+    uint32_t period = fake_tim2.ARR + 1U;
+
+    for(uint8_t ch = 0; ch < 4; ch++)
+    {
+        if(fake_tim2.DIER & (TIM_DIER_CC1IE << ch))
+        {
+            uint32_t ccr = (&fake_tim2.CCR1)[ch];
+            uint32_t delta = (ccr + period - fake_tim2.CNT) % period;
+            uint64_t event = tim2_origin + (now_tick + ((delta == 0) ? period : delta)) * (fake_tim2.PSC + 1U);
+
+            if(event < next)
+            {
+                next = event;
+                *flags = 0;
+            }
+            if(event == next)
+            {
+                *flags |= (TIM_SR_CC1IF << ch);
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Apply a direct BSRR write of the application to ODR (set wins like on the target)
+ * @note  applied at the next GPIO call or time step, two writes in between merge to the last
+ */
+static void gpio_apply_bsrr(GPIO_TypeDef* GPIOx)
+{
+    uint32_t bsrr = GPIOx->BSRR;
+
+    if(bsrr != 0)
+    {
+        GPIOx->ODR &= ~(bsrr >> 16);
+        GPIOx->ODR |= (bsrr & 0xFFFFU);
+        GPIOx->BSRR = 0;
+    }
+}
+
+static void set_cycles(uint64_t cycles)
+{
+    gpio_apply_bsrr(&fake_gpiob);
+    now_cycles = cycles;
+    fake_dwt.CYCCNT = (uint32_t)cycles;
+    tim2_update();
+}
+
+/**
+ * @brief Hand the pending USB data to the application, packet by packet
+ */
+static void usb_deliver(void)
+{
+    extern uint8_t USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len);
+    uint32_t offset = 0;
+
+    while(!usb_paused && (offset < usb_pending_length))
+    {
+        uint32_t length = usb_pending_length - offset;
+        if(length > FAKE_USB_PACKET_SIZE)
+        {
+            length = FAKE_USB_PACKET_SIZE;
+        }
+        usb_paused = !USB_CDC_RxHandler((uint8_t*)&usb_pending[offset], length);
+        offset += length;
+    }
+    memmove(usb_pending, &usb_pending[offset], usb_pending_length - offset);
+    usb_pending_length -= offset;
+}
+
+/* ============================================================================
+ *                         HAL FUNCTIONS
+ * ============================================================================ */
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(now_cycles / (SystemCoreClock / 1000U));
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    fake_hal_advance_us(Delay * 1000U);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    gpio_apply_bsrr(GPIOx);
+    if(PinState == GPIO_PIN_SET)
+    {
+        GPIOx->ODR |= GPIO_Pin;
+    }
+    else
+    {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    gpio_apply_bsrr(GPIOx);
+    return (GPIOx->ODR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    gpio_apply_bsrr(GPIOx);
+    GPIOx->ODR ^= GPIO_Pin;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+    (void)IRQn;
+    (void)PreemptPriority;
+    (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    (void)IRQn;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)Timeout;
+
+    if(huart == UART_DEBUG)
+    {
+        capture_append(&debug_capture, pData, Size);
+        if(debug_verbose < 0)
+        {
+            debug_verbose = (getenv("LX200_HOST_VERBOSE") != NULL);
+        }
+        if(debug_verbose)
+        {
+            fwrite(pData, 1, Size, stderr);
+        }
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* pData, uint16_t Size)
+{
+    if((huart != UART_OUT) || (tx_dma_length != 0))
+    {
+        return HAL_BUSY;
+    }
+
+    tx_dma_data = pData;
+    tx_dma_length = Size;
+    // 8N1: 10 bits per byte
+    tx_dma_done = now_cycles + (uint64_t)Size * SystemCoreClock * 10U / huart->Init.BaudRate;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size)
+{
+    if(huart != UART_OUT)
+    {
+        return HAL_ERROR;
+    }
+
+    rx_dma_buffer = pData;
+    rx_dma_size = Size;
+    rx_dma_pos = 0;
+    huart->ErrorCode = HAL_UART_ERROR_NONE;
+    return HAL_OK;
+}
+
+uint32_t HAL_UART_GetError(UART_HandleTypeDef* huart)
+{
+    return huart->ErrorCode;
+}
+
+/**
+ * @brief Program a halfword like the FLASH controller: only erased halfwords
+ *        or 0x0000, the core stalls FAKE_FLASH_PROGRAM_US
+ */
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data)
+{
+    uintptr_t offset = Address - (uintptr_t)fake_flash;
+    uint16_t value = (uint16_t)Data;
+    uint16_t current;
+
+    if(flash_locked || (TypeProgram != FLASH_TYPEPROGRAM_HALFWORD) || (offset >= FAKE_FLASH_SIZE) || (offset & 1U))
+    {
+        return HAL_ERROR;
+    }
+    fake_hal_advance_us(FAKE_FLASH_PROGRAM_US);
+    if(flash_cut == 0)
+    {
+        return HAL_OK;
+    }
+    flash_cut -= (flash_cut != UINT32_MAX) ? 1U : 0U;
+
+    memcpy(&current, &fake_flash[offset], sizeof(current));
+    if((current != 0xFFFFU) && (value != 0))
+    {
+        // PGERR
+        return HAL_ERROR;
+    }
+    memcpy(&fake_flash[offset], &value, sizeof(value));
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* PageError)
+{
+    uintptr_t offset = pEraseInit->PageAddress - (uintptr_t)fake_flash;
+
+    *PageError = 0xFFFFFFFFU;
+    if(flash_locked || (offset % FLASH_PAGE_SIZE) || (offset + pEraseInit->NbPages * FLASH_PAGE_SIZE > FAKE_FLASH_SIZE))
+    {
+        return HAL_ERROR;
+    }
+    fake_hal_advance_us(pEraseInit->NbPages * FAKE_FLASH_ERASE_US);
+    if(flash_cut == 0)
+    {
+        return HAL_OK;
+    }
+    memset(&fake_flash[offset], 0xFF, pEraseInit->NbPages * FLASH_PAGE_SIZE);
+    flash_erases += pEraseInit->NbPages;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    flash_locked = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    flash_locked = 1;
+    return HAL_OK;
+}
+
+/* ============================================================================
+ *                         USB CDC FUNCTIONS
+ * ============================================================================ */
+
+uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
+{
+    if(usb_busy)
+    {
+        cdc_stats.dropped += Len;
+        return USBD_BUSY;
+    }
+
+    capture_append(&usb_capture, Buf, Len);
+    if(usb_listener != NULL)
+    {
+        usb_listener(Buf, Len);
+    }
+    cdc_stats.queued += Len;
+    cdc_stats.transfers++;
+    return USBD_OK;
+}
+
+const CDC_TxStatsTypeDef* CDC_GetTxStats_FS(void)
+{
+    return &cdc_stats;
+}
+
+void CDC_ResumeReceive_FS(void)
+{
+    usb_paused = 0;
+    usb_deliver();
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * @brief Advance the virtual time
+ * @note  completes the running mount UART transfer when its last byte is out
+ */
+void fake_hal_advance_us(uint32_t us)
+{
+    uint64_t target = now_cycles + (uint64_t)us * (SystemCoreClock / 1000000U);
+
+    for(;;)
+    {
+        uint32_t flags = 0;
+        uint64_t tim_event = tim2_next_event(&flags);
+        uint64_t dma_event = (tx_dma_length != 0) ? tx_dma_done : UINT64_MAX;
+
+        if((tim_event > target) && (dma_event > target))
+        {
+            break;
+        }
+        if(tim_event <= dma_event)
+        {
+            set_cycles(tim_event);
+            fake_tim2.SR |= flags;
+            TIM2_IRQHandler();
+            gpio_apply_bsrr(&fake_gpiob);
+            continue;
+        }
+
+        const uint8_t* data = tx_dma_data;
+        uint16_t length = tx_dma_length;
+
+        set_cycles(tx_dma_done);
+        tx_dma_length = 0;
+        capture_append(&uart_capture, data, length);
+        if(uart_listener != NULL)
+        {
+            uart_listener(data, length);
+        }
+        HAL_UART_TxCpltCallback(UART_OUT);
+    }
+    set_cycles(target);
+}
+
+uint64_t fake_hal_time_us(void)
+{
+    return now_cycles / (SystemCoreClock / 1000000U);
+}
+
+/**
+ * @brief Data sent by the USB host, split into full speed packets
+ */
+void fake_usb_receive(const char* data)
+{
+    fake_usb_receive_bytes((const uint8_t*)data, strlen(data));
+}
+
+void fake_usb_receive_bytes(const uint8_t* data, uint32_t length)
+{
+    if((usb_pending_length + length) > sizeof(usb_pending))
+    {
+        length = sizeof(usb_pending) - usb_pending_length;
+    }
+    memcpy(&usb_pending[usb_pending_length], data, length);
+    usb_pending_length += length;
+    usb_deliver();
+}
+
+/**
+ * @brief Bytes received but not accepted yet (the endpoint NAKs)
+ */
+uint32_t fake_usb_pending(void)
+{
+    return usb_pending_length;
+}
+
+/**
+ * @brief Simulate a full USB ring buffer, CDC_Transmit_FS drops the data
+ */
+void fake_usb_set_busy(uint8_t busy)
+{
+    usb_busy = busy;
+}
+
+const char* fake_usb_output(void)
+{
+    return usb_capture.data;
+}
+
+void fake_usb_clear(void)
+{
+    capture_clear(&usb_capture);
+}
+
+void fake_usb_set_listener(fake_listener_t listener)
+{
+    usb_listener = listener;
+}
+
+/**
+ * @brief Data sent by the mount, reported like the DMA with IDLE detection
+ *        (half and full buffer events while filling, IDLE at the end)
+ */
+void fake_uart_receive(const char* data)
+{
+    fake_uart_receive_bytes((const uint8_t*)data, strlen(data));
+}
+
+void fake_uart_receive_bytes(const uint8_t* data, uint32_t length)
+{
+    if(rx_dma_buffer == NULL)
+    {
+        return;
+    }
+    for(uint32_t i = 0; i < length; i++)
+    {
+        rx_dma_buffer[rx_dma_pos++] = data[i];
+        if((rx_dma_pos == rx_dma_size / 2) || (rx_dma_pos == rx_dma_size))
+        {
+            HAL_UARTEx_RxEventCallback(UART_OUT, rx_dma_pos);
+        }
+        if(rx_dma_pos == rx_dma_size)
+        {
+            rx_dma_pos = 0;
+        }
+    }
+    // IDLE line, nothing new if the data ended on a half / full buffer event
+    HAL_UARTEx_RxEventCallback(UART_OUT, rx_dma_pos);
+}
+
+/**
+ * @brief UART error, aborts the DMA reception like the HAL
+ */
+void fake_uart_error(uint32_t error)
+{
+    (UART_OUT)->ErrorCode = error;
+    rx_dma_buffer = NULL;
+    HAL_UART_ErrorCallback(UART_OUT);
+}
+
+const char* fake_uart_output(void)
+{
+    return uart_capture.data;
+}
+
+void fake_uart_clear(void)
+{
+    capture_clear(&uart_capture);
+}
+
+void fake_uart_set_listener(fake_listener_t listener)
+{
+    uart_listener = listener;
+}
+
+const char* fake_debug_output(void)
+{
+    return debug_capture.data;
+}
+
+void fake_debug_clear(void)
+{
+    capture_clear(&debug_capture);
+}
+
+/**
+ * @brief Erase the configuration pages, a new device
+ */
+void fake_flash_reset(void)
+{
+    memset(fake_flash, 0xFF, sizeof(fake_flash));
+    flash_cut = UINT32_MAX;
+}
+
+/**
+ * @brief Power fails after count more halfwords: later programs and erases
+ *        return HAL_OK without changing the flash, UINT32_MAX restores the power
+ */
+void fake_flash_cut_after(uint32_t count)
+{
+    flash_cut = count;
+}
+
+uint32_t fake_flash_erase_count(void)
+{
+    return flash_erases;
+}
@@ -0,0 +1,197 @@
+/*
+ ******************************************************************************
+ * @file    host_board.c
+ * @brief   Host replacement of main.c: peripherals, callbacks and main loop
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Keep host_board_loop() in the order of the main loop in Core/Src/main.c.
+ * host_board_run_ms() replaces the WFI sleep: a pass runs in the ms an
+ * event is posted or a deadline is reached, like on the target.
+ * The mount UART is connected to the scripted FS2 of fake_fs2.c.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "main.h"
+#include "usbd_cdc_if.h"
+#include "st4_handler.h"
+#include "mount_link.h"
+#include "mount_reply.h"
+#include "mount_poller.h"
+#include "mount_rtt.h"
+#include "lx200_server.h"
+#include "perf_counter.h"
+#include "scheduler.h"
+#include "event_loop.h"
+#include "config_store.h"
+#include "fake_hal.h"
+#include "fake_fs2.h"
+#include "host_board.h"
+
+/* ============================================================================
+ *                         PUBLIC VARIABLES
+ * ============================================================================ */
+UART_HandleTypeDef huart1 = { .Init = { .BaudRate = 115200 } };
+UART_HandleTypeDef huart2 = { .Init = { .BaudRate = 9600 } };
+UART_HandleTypeDef huart3 = { .Init = { .BaudRate = 115200 } };
+
+volatile uint32_t usb_isr_max_cycles = 0;
+volatile uint32_t main_loop_max_cycles = 0;
+uint32_t debug_tx_bytes = 0;
+
+/* ============================================================================
+ *                         APPLICATION CALLBACKS
+ * ============================================================================ */
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    if(huart == UART_OUT)
+    {
+        mount_link_rx_event(Size);
+        event_post(EVENT_MOUNT_RX);
+    }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if(huart == UART_OUT)
+    {
+        mount_link_tx_complete();
+        event_post(EVENT_MOUNT_TX);
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if(huart == UART_OUT)
+    {
+        mount_link_error();
+        event_post(EVENT_MOUNT_RX);
+    }
+}
+
+uint8_t USB_CDC_RxHandler(uint8_t* Buf, uint32_t Len)
+{
+    uint32_t isr_start = perf_cycles();
+    uint8_t result = QueueLX200Data(Buf, Len);
+
+    event_post(EVENT_USB_RX);
+    perf_track_max(&usb_isr_max_cycles, isr_start);
+    return result;
+}
+
+void TIM2_IRQHandler(void)
+{
+    st4_timer_irq();
+}
+
+void UART_Printf(UART_HandleTypeDef *huart, const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if(len > 0 && len < (int)sizeof(buffer))
+    {
+        HAL_UART_Transmit(huart, (uint8_t*)buffer, len, HAL_MAX_DELAY);
+        if(huart == UART_DEBUG)
+        {
+            debug_tx_bytes += len;
+        }
+    }
+}
+
+void Error_Handler(void)
+{
+    fprintf(stderr, "Error_Handler called\n");
+    abort();
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void host_board_init(void)
+{
+    perf_init();
+    HAL_GPIO_WritePin(GPIOB, ST4_EAST_Pin|ST4_NORTH_Pin|ST4_SOUTH_Pin|ST4_WEST_Pin, GPIO_PIN_SET);
+    mount_link_init();
+    st4_init();
+    fake_flash_reset();
+    config_init();
+    mount_poller_init();
+    mount_rtt_init();
+    fake_fs2_init();
+}
+
+/**
+ * @brief One iteration of the main loop, without the idle wait
+ */
+void host_board_loop(void)
+{
+    uint32_t loop_start;
+
+    event_wait(0);
+    loop_start = perf_cycles();
+
+    ProcessLX200Queue();
+    st4_commit();
+    CDC_ResumeReceive_FS();
+    mount_reply_process();
+    mount_poller_process();
+    sched_process();
+    perf_track_max(&main_loop_max_cycles, loop_start);
+    event_pass_end();
+}
+
+/**
+ * @brief Time until the nearest deadline, NextDeadlineMs() of main.c
+ */
+uint32_t host_board_next_ms(void)
+{
+    uint32_t deadlines[] = {
+        mount_reply_next_ms(),
+        mount_poller_next_ms(),
+        sched_next_ms(),
+    };
+    uint32_t next = EVENT_MAX_SLEEP_MS;
+
+    for(uint8_t i = 0; i < sizeof(deadlines) / sizeof(deadlines[0]); i++)
+    {
+        if(deadlines[i] < next)
+        {
+            next = deadlines[i];
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Run the main loop for a virtual time span in 1ms steps, a pass runs
+ *        only in the steps with a posted event or a reached deadline
+ * @note  the scripted FS2 mount answers in between
+ */
+void host_board_run_ms(uint32_t ms)
+{
+    uint32_t due_tick = HAL_GetTick();
+
+    for(uint32_t i = 0; i < ms; i++)
+    {
+        fake_fs2_process();
+        if((event_pending() != 0) || ((int32_t)(HAL_GetTick() - due_tick) >= 0))
+        {
+            host_board_loop();
+            due_tick = HAL_GetTick() + host_board_next_ms();
+        }
+        HAL_Delay(1);
+    }
+}
@@ -0,0 +1,242 @@
+/*
+ ******************************************************************************
+ * @file    host_proxy.c
+ * @brief   Proxy on the host: client on a pseudo terminal, mount on a serial port
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Runs the host build in real time: the virtual time follows the monotonic
+ * clock, the client side (USB CDC on the target) is a pseudo terminal and the
+ * mount UART is a serial device, e.g. the pty of testing/fs2_simulator.py.
+ * Bytes for the mount are written when they would have left USART2 at the
+ * configured baud rate.
+ *
+ * Usage: lx200_proxy_host --mount <device> [--link <path>]
+ *   --link: symlink to the client pty, e.g. /tmp/lx200 for lx200_client.py
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "fake_hal.h"
+#include "host_board.h"
+#include "proxy_stats.h"
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static int client_fd = -1;
+static int mount_fd = -1;
+static volatile sig_atomic_t running = 1;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+static void stop(int signal_number)
+{
+    (void)signal_number;
+    running = 0;
+}
+
+static void write_all(int fd, const uint8_t* data, uint16_t length)
+{
+    while(length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+
+        if(written < 0)
+        {
+            if(errno == EAGAIN)
+            {
+                usleep(100);
+                continue;
+            }
+            return; // client closed, the data is lost like on a disconnected USB
+        }
+        data += written;
+        length -= (uint16_t)written;
+    }
+}
+
+static void to_client(const uint8_t* data, uint16_t length)
+{
+    write_all(client_fd, data, length);
+}
+
+static void to_mount(const uint8_t* data, uint16_t length)
+{
+    write_all(mount_fd, data, length);
+}
+
+static int set_raw(int fd)
+{
+    struct termios tio;
+
+    if(tcgetattr(fd, &tio) != 0)
+    {
+        return -1;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B9600);
+    cfsetospeed(&tio, B9600);
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+/**
+ * @brief Create the client pty, the slave stays open so the master never sees a hangup
+ */
+static int open_client(const char* link)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0))
+    {
+        perror("lx200_proxy_host: pty");
+        return -1;
+    }
+
+    const char* name = ptsname(fd);
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if((slave < 0) || (set_raw(slave) != 0))
+    {
+        perror("lx200_proxy_host: pty slave");
+        return -1;
+    }
+
+    if(link != NULL)
+    {
+        unlink(link);
+        if(symlink(name, link) != 0)
+        {
+            perror("lx200_proxy_host: symlink");
+        }
+    }
+    printf("client: %s%s%s\n", name, (link != NULL) ? " -> " : "", (link != NULL) ? link : "");
+    return fd;
+}
+
+static int read_into(int fd, void (*receive)(const uint8_t* data, uint32_t length))
+{
+    uint8_t buffer[256];
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+
+    if(length > 0)
+    {
+        receive(buffer, (uint32_t)length);
+    }
+    return (length < 0) && (errno != EAGAIN) && (errno != EIO) ? -1 : 0;
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+int main(int argc, char** argv)
+{
+    const char* mount = NULL;
+    const char* link = NULL;
+    char stats[PROXY_STATS_FRAME_SIZE];
+
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--mount") == 0) && (i + 1 < argc))
+        {
+            mount = argv[++i];
+        }
+        else if((strcmp(argv[i], "--link") == 0) && (i + 1 < argc))
+        {
+            link = argv[++i];
+        }
+        else
+        {
+            mount = NULL;
+            break;
+        }
+    }
+    if(mount == NULL)
+    {
+        fprintf(stderr, "usage: lx200_proxy_host --mount <device> [--link <path>]\n");
+        return 2;
+    }
+
+    mount_fd = open(mount, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if((mount_fd < 0) || (set_raw(mount_fd) != 0))
+    {
+        perror("lx200_proxy_host: mount");
+        return 1;
+    }
+    client_fd = open_client(link);
+    if(client_fd < 0)
+    {
+        return 1;
+    }
+    fflush(stdout);
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    host_board_init();
+    fake_uart_set_listener(to_mount);
+    fake_usb_set_listener(to_client);
+
+    uint64_t last_us = monotonic_us();
+    while(running)
+    {
+        struct pollfd fds[2] = {
+            { .fd = client_fd, .events = POLLIN },
+            { .fd = mount_fd,  .events = POLLIN },
+        };
+
+        // the client is only read while the receive queue accepts packets, like the USB NAK
+        fds[0].fd = (fake_usb_pending() == 0) ? client_fd : -1;
+        poll(fds, 2, 1);
+
+        if((fds[0].revents & POLLIN) && (read_into(client_fd, fake_usb_receive_bytes) != 0))
+        {
+            break;
+        }
+        if((fds[1].revents & POLLIN) && (read_into(mount_fd, fake_uart_receive_bytes) != 0))
+        {
+            fprintf(stderr, "lx200_proxy_host: mount closed\n");
+            break;
+        }
+
+        uint64_t now_us = monotonic_us();
+        fake_hal_advance_us((uint32_t)(now_us - last_us));
+        last_us = now_us;
+        host_board_loop();
+        fake_usb_clear();
+        fake_uart_clear();
+        fake_debug_clear();
+    }
+
+    proxy_stats_format(stats, sizeof(stats));
+    fprintf(stderr, "statistics: %s\n", stats);
+    if(link != NULL)
+    {
+        unlink(link);
+    }
+    return 0;
+}
@@ -0,0 +1,274 @@
+#!/usr/bin/env python3
+"""
+******************************************************************************
+* @file    fs2_simulator.py
+* @brief   FS2 mount simulator on a pseudo terminal
+* @author  LX200 Proxy Project
+* @date    2025
+******************************************************************************
+
+Behaves like an FS2 controller on its serial port at 9600 baud: replies
+leave one byte time (10 bits) apart after the firmware delay, the mount
+slews to the target, and the known FS2 quirks are reproduced:
+
+- :Sr / :Sd are rejected with "0" without a space after the command
+  (":Sr HH:MM:SS#" / ":Sd sDD*MM:SS#")
+- :MS# and :Q# are aborted now and then (reply "0", but nothing happens),
+  the proxy sends them twice
+
+Usage with the host build of the proxy:
+    python3 testing/fs2_simulator.py --link /tmp/fs2
+    build/lx200_proxy_host --mount /tmp/fs2 --link /tmp/lx200
+    python3 testing/lx200_client.py          (port /tmp/lx200)
+"""
+
+import argparse
+import os
+import random
+import select
+import sys
+import time
+import tty
+
+SIDEREAL_RATE = 15.041 / 3600.0     # deg/s
+RATES = {                           # deg/s for :RS# :RM# :RC# :RG#
+    "S": 3.0,
+    "M": 0.5,
+    "C": 8 * SIDEREAL_RATE,
+    "G": SIDEREAL_RATE,
+}
+DISTANCE_BAR = "\x7f"
+
+
+class FS2Simulator:
+    def __init__(self, baud=9600, reply_delay=0.005, abort_rate=0.3, seed=None, verbose=False):
+        self.byte_time = 10.0 / baud
+        self.reply_delay = reply_delay
+        self.abort_rate = abort_rate
+        self.random = random.Random(seed)
+        self.verbose = verbose
+
+        # position and target in degrees
+        self.ra = 83.82
+        self.dec = -5.39
+        self.target_ra = self.ra
+        self.target_dec = self.dec
+        self.slewing = False
+        self.rate = RATES["S"]
+        self.moves = {}             # direction -> active manual move
+        self.high_precision = True
+
+        self.command = ""
+        self.output = bytearray()
+        self.next_byte_time = 0.0
+        self.reply_time = 0.0
+        self.last_update = time.monotonic()
+        self.stats = {"commands": 0, "aborted": 0, "rejected": 0}
+
+    # ------------------------------------------------------------------
+    # Coordinates
+    # ------------------------------------------------------------------
+    @staticmethod
+    def parse_sexagesimal(text, separators):
+        """'05:35:17' or '-05*23:28' -> degrees (hours for RA), None if invalid"""
+        sign = -1.0 if text.startswith("-") else 1.0
+        text = text.lstrip("+-")
+        for sep in separators:
+            text = text.replace(sep, ":")
+        try:
+            parts = [float(p) for p in text.split(":")]
+        except ValueError:
+            return None
+        if len(parts) not in (2, 3):
+            return None
+        value = parts[0] + parts[1] / 60.0 + (parts[2] / 3600.0 if len(parts) == 3 else 0.0)
+        return sign * value
+
+    def format_ra(self):
+        seconds = int(round((self.ra % 360.0) / 15.0 * 3600.0)) % 86400
+        if self.high_precision:
+            return "%02d:%02d:%02d#" % (seconds // 3600, seconds // 60 % 60, seconds % 60)
+        tenths = seconds // 6
+        return "%02d:%02d.%d#" % (tenths // 600, tenths // 10 % 60, tenths % 10)
+
+    def format_dec(self):
+        arcsec = int(round(abs(self.dec) * 3600.0))
+        sign = "-" if self.dec < 0 else "+"
+        if self.high_precision:
+            return "%s%02d*%02d:%02d#" % (sign, arcsec // 3600, arcsec // 60 % 60, arcsec % 60)
+        return "%s%02d*%02d#" % (sign, arcsec // 3600, arcsec // 60 % 60)
+
+    # ------------------------------------------------------------------
+    # Motion
+    # ------------------------------------------------------------------
+    def update(self, now):
+        elapsed = now - self.last_update
+        self.last_update = now
+
+        if self.slewing:
+            step = RATES["S"] * elapsed
+            d_ra = (self.target_ra - self.ra + 180.0) % 360.0 - 180.0
+            d_dec = self.target_dec - self.dec
+            self.ra = (self.ra + max(-step, min(step, d_ra))) % 360.0
+            self.dec += max(-step, min(step, d_dec))
+            if abs(d_ra) <= step and abs(d_dec) <= step:
+                self.slewing = False
+
+        for direction in self.moves:
+            step = self.rate * elapsed
+            if direction == "n":
+                self.dec = min(90.0, self.dec + step)
+            elif direction == "s":
+                self.dec = max(-90.0, self.dec - step)
+            elif direction == "e":
+                self.ra = (self.ra - step) % 360.0
+            elif direction == "w":
+                self.ra = (self.ra + step) % 360.0
+
+    def aborted(self):
+        if self.random.random() < self.abort_rate:
+            self.stats["aborted"] += 1
+            return True
+        return False
+
+    # ------------------------------------------------------------------
+    # Commands
+    # ------------------------------------------------------------------
+    def execute(self, command):
+        """Returns the reply of a complete command, None for no reply"""
+        self.stats["commands"] += 1
+        body = command[1:-1]
+
+        if body == "GR":
+            return self.format_ra()
+        if body == "GD":
+            return self.format_dec()
+        if body.startswith("Sr") or body.startswith("Sd"):
+            if not body[2:3] == " ":
+                self.stats["rejected"] += 1
+                return "0"
+            value = self.parse_sexagesimal(body[3:].strip(), "*\xdf")
+            if value is None:
+                self.stats["rejected"] += 1
+                return "0"
+            if body.startswith("Sr"):
+                self.target_ra = (value * 15.0) % 360.0
+            else:
+                self.target_dec = value
+            return "1"
+        if body == "MS":
+            if not self.aborted():
+                self.slewing = True
+            return "0"
+        if body == "Q":
+            if not self.aborted():
+                self.slewing = False
+                self.moves.clear()
+            return None
+        if body == "CM":
+            self.ra = self.target_ra
+            self.dec = self.target_dec
+            return "Coordinates     matched.        #"
+        if body == "D":
+            return (DISTANCE_BAR + "#") if self.slewing else "#"
+        if body in ("Mn", "Ms", "Me", "Mw"):
+            self.moves[body[1]] = True
+            return None
+        if body in ("Qn", "Qs", "Qe", "Qw"):
+            self.moves.pop(body[1], None)
+            return None
+        if body in ("RS", "RM", "RC", "RG"):
+            self.rate = RATES[body[1]]
+            return None
+        if body == "U":
+            self.high_precision = not self.high_precision
+            return None
+        return None
+
+    def receive(self, data, now):
+        for char in data.decode("latin-1"):
+            # ':' inside a command is part of the coordinates
+            if not self.command:
+                if char == ":":
+                    self.command = ":"
+            else:
+                self.command += char
+                if char == "#":
+                    self.update(now)
+                    reply = self.execute(self.command)
+                    if self.verbose:
+                        print("%s -> %s" % (self.command, reply if reply is not None else "-"), file=sys.stderr)
+                    self.command = ""
+                    if reply:
+                        self.queue(reply, now + self.reply_delay)
+
+    def queue(self, reply, due):
+        if not self.output:
+            self.next_byte_time = due
+        self.output.extend(reply.encode("latin-1"))
+
+    def transmit(self, fd, now):
+        """Send the bytes that are due, one byte time apart"""
+        count = 0
+        while count < len(self.output) and self.next_byte_time + count * self.byte_time <= now:
+            count += 1
+        if count:
+            os.write(fd, bytes(self.output[:count]))
+            del self.output[:count]
+            self.next_byte_time += count * self.byte_time
+
+    def next_timeout(self, now):
+        if self.output:
+            return max(0.0, self.next_byte_time - now)
+        return 0.05
+
+    def run(self, fd):
+        while True:
+            now = time.monotonic()
+            readable, _, _ = select.select([fd], [], [], self.next_timeout(now))
+            now = time.monotonic()
+            if readable:
+                try:
+                    data = os.read(fd, 256)
+                except OSError:
+                    data = b""     # no client connected yet
+                if data:
+                    self.receive(data, now)
+                else:
+                    time.sleep(0.01)
+            self.update(now)
+            self.transmit(fd, now)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="FS2 mount simulator on a pseudo terminal")
+    parser.add_argument("--link", help="symlink to the pty, e.g. /tmp/fs2")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--reply-delay-ms", type=float, default=5.0, help="firmware reply time")
+    parser.add_argument("--abort-rate", type=float, default=0.3, help="share of aborted :MS# / :Q#")
+    parser.add_argument("--seed", type=int, help="seed for the aborted commands")
+    parser.add_argument("--verbose", action="store_true", help="print commands on stderr")
+    args = parser.parse_args()
+
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    name = os.ttyname(slave)
+    if args.link:
+        if os.path.lexists(args.link):
+            os.unlink(args.link)
+        os.symlink(name, args.link)
+    print("FS2 simulator on %s%s" % (name, " -> " + args.link if args.link else ""), flush=True)
+
+    simulator = FS2Simulator(args.baud, args.reply_delay_ms / 1000.0, args.abort_rate, args.seed, args.verbose)
+    try:
+        simulator.run(master)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.link and os.path.islink(args.link):
+            os.unlink(args.link)
+        print("statistics: %s" % simulator.stats, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
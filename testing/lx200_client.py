@@ -2,20 +2,28 @@
 """
 ******************************************************************************
 * @file    lx200_client.py
-* @brief   LX200 Protocol Test Client with GUI
+* @brief   LX200 Protocol Test Client with GUI and headless benchmark
 * @author  LX200 Proxy Project
 * @date    2025
 ******************************************************************************
 """
 
-import tkinter as tk
-from tkinter import ttk, scrolledtext, messagebox
+import argparse
+import re
 import serial
+import sys
 import threading
 import time
 from datetime import datetime
 import json
 
+# the GUI is optional, the headless benchmark runs without a display
+try:
+    import tkinter as tk
+    from tkinter import ttk, scrolledtext, messagebox
+except ImportError:
+    tk = None
+
 class LX200TestClient:
     def __init__(self, root):
         self.root = root
@@ -579,7 +587,431 @@ class LX200TestClient:
         self.progress_var.set("Stopped")
         self.log_message("Test sequence stopped by user", "red")
 
+# ----------------------------------------------------------------------------
+# Headless benchmark
+# ----------------------------------------------------------------------------
+REPLY_NONE = "none"     # guide pulses, moves, :Q#, rates
+REPLY_CHAR = "char"     # single character, e.g. :Sr / :Sd, ACK
+REPLY_GOTO = "goto"     # :MS#, "0" or "1"/"2" + message + "#"
+REPLY_HASH = "hash"     # terminated by '#'
+
+DEFAULT_MIX = ":GR#=4,:GD#=4,:Mgn0100#=1,:Mge0100#=1,:GM#=1"
+
+REPLY_PATTERNS = {
+    ":GR#": re.compile(rb"^\d{2}:\d{2}(:\d{2}|\.\d)#$"),
+    ":GD#": re.compile(rb"^[+-]\d{2}[*\xdf]\d{2}(:\d{2})?#$"),
+}
+
+
+def reply_kind(command):
+    """Reply type of an LX200 command, decides how the reply is read"""
+    if command == "\x06":
+        return REPLY_CHAR
+    if command.startswith((":Sr", ":Sd")):
+        return REPLY_CHAR
+    if command == ":MS#":
+        return REPLY_GOTO
+    if re.match(r"^:(Mg[nsew]\d*|M[nsew]|Q[nsew]?|R[SMCG]|U)#$", command):
+        return REPLY_NONE
+    return REPLY_HASH
+
+
+def parse_mix(text):
+    """':GR#=4,:GD#=4' -> [(':GR#', 4), (':GD#', 4)]"""
+    mix = []
+    for item in text.split(","):
+        command, _, weight = item.strip().rpartition("=")
+        if not command:
+            command, weight = weight, "1"
+        mix.append((command.replace("\\x06", "\x06"), int(weight)))
+    return mix
+
+
+def percentile(values, percent):
+    """Nearest rank percentile of a sorted list"""
+    if not values:
+        return None
+    rank = max(1, int(round(percent / 100.0 * len(values) + 0.4999)))
+    return values[min(rank, len(values)) - 1]
+
+
+class HeadlessBenchmark:
+    """Sends a weighted command mix at a target rate and measures each reply
+    with blocking reads and time.perf_counter_ns"""
+
+    def __init__(self, port, baudrate=115200, timeout=2.0):
+        self.serial_connection = serial.Serial(port=port, baudrate=baudrate, timeout=timeout)
+        self.timeout = timeout
+        self.stats = {}
+        self.stray_bytes = 0
+
+    def close(self):
+        self.serial_connection.close()
+
+    def _command_stats(self, command):
+        return self.stats.setdefault(command, {"sent": 0, "replies": 0, "timeouts": 0, "errors": 0, "latency_ns": []})
+
+    def _read_reply(self, kind, deadline_ns):
+        """Blocking read of one reply, returns the bytes (incomplete on timeout)"""
+        connection = self.serial_connection
+        remaining = max(0.0, (deadline_ns - time.perf_counter_ns()) / 1e9)
+
+        connection.timeout = remaining
+        if kind == REPLY_CHAR:
+            return connection.read(1)
+        if kind == REPLY_GOTO:
+            first = connection.read(1)
+            if first in (b"", b"0"):
+                return first
+            connection.timeout = max(0.0, (deadline_ns - time.perf_counter_ns()) / 1e9)
+            return first + connection.read_until(b"#")
+        return connection.read_until(b"#")
+
+    def _reply_ok(self, command, kind, reply):
+        if kind == REPLY_CHAR:
+            return len(reply) == 1
+        if kind == REPLY_GOTO:
+            return reply == b"0" or (len(reply) > 1 and reply.endswith(b"#"))
+        pattern = REPLY_PATTERNS.get(command)
+        if pattern is not None:
+            return bool(pattern.match(reply))
+        return reply.endswith(b"#")
+
+    def execute(self, command):
+        """Send one command and wait for its reply, returns the latency in ns or None"""
+        connection = self.serial_connection
+        kind = reply_kind(command)
+        stats = self._command_stats(command)
+
+        # bytes left over from a timed out reply would be taken for this one
+        waiting = connection.in_waiting
+        if waiting:
+            self.stray_bytes += waiting
+            connection.reset_input_buffer()
+
+        start_ns = time.perf_counter_ns()
+        connection.write(command.encode("latin-1"))
+        stats["sent"] += 1
+        if kind == REPLY_NONE:
+            return None
+
+        reply = self._read_reply(kind, start_ns + int(self.timeout * 1e9))
+        latency_ns = time.perf_counter_ns() - start_ns
+
+        complete = reply and (kind == REPLY_CHAR or reply.endswith(b"#") or (kind == REPLY_GOTO and reply == b"0"))
+        if not complete:
+            stats["timeouts"] += 1
+            return None
+        if not self._reply_ok(command, kind, reply):
+            stats["errors"] += 1
+            return None
+        stats["replies"] += 1
+        stats["latency_ns"].append(latency_ns)
+        return latency_ns
+
+    def run(self, mix, rate, count=None, duration=None, seed=None):
+        """Open loop schedule: command i is due at start + i / rate, late commands are sent at once"""
+        import random
+        rng = random.Random(seed)
+        commands = [command for command, _ in mix]
+        weights = [weight for _, weight in mix]
+        interval_ns = int(1e9 / rate) if rate > 0 else 0
+        late = 0
+
+        start_ns = time.perf_counter_ns()
+        index = 0
+        while True:
+            now_ns = time.perf_counter_ns()
+            if count is not None and index >= count:
+                break
+            if duration is not None and now_ns - start_ns >= duration * 1e9:
+                break
+
+            due_ns = start_ns + index * interval_ns
+            if due_ns > now_ns:
+                time.sleep((due_ns - now_ns) / 1e9)
+            elif interval_ns and now_ns - due_ns > interval_ns:
+                late += 1
+
+            self.execute(rng.choices(commands, weights)[0])
+            index += 1
+
+        elapsed_ns = time.perf_counter_ns() - start_ns
+        return self.report(rate, elapsed_ns, late)
+
+    @staticmethod
+    def _summary(values_ns):
+        values = sorted(values_ns)
+        if not values:
+            return {"p50_us": None, "p90_us": None, "p99_us": None, "max_us": None, "mean_us": None}
+        return {
+            "p50_us": round(percentile(values, 50) / 1000.0, 1),
+            "p90_us": round(percentile(values, 90) / 1000.0, 1),
+            "p99_us": round(percentile(values, 99) / 1000.0, 1),
+            "max_us": round(values[-1] / 1000.0, 1),
+            "mean_us": round(sum(values) / len(values) / 1000.0, 1),
+        }
+
+    def report(self, rate, elapsed_ns, late):
+        commands = {}
+        all_latencies = []
+        totals = {"sent": 0, "replies": 0, "timeouts": 0, "errors": 0}
+
+        for command, stats in sorted(self.stats.items()):
+            entry = {key: stats[key] for key in totals}
+            entry.update(self._summary(stats["latency_ns"]))
+            commands[repr(command)[1:-1]] = entry
+            all_latencies.extend(stats["latency_ns"])
+            for key in totals:
+                totals[key] += stats[key]
+
+        elapsed_s = elapsed_ns / 1e9
+        overall = dict(totals)
+        overall.update(self._summary(all_latencies))
+        return {
+            "target_rate": rate,
+            "elapsed_s": round(elapsed_s, 3),
+            "throughput_cps": round(totals["sent"] / elapsed_s, 1) if elapsed_s > 0 else 0.0,
+            "late": late,
+            "stray_bytes": self.stray_bytes,
+            "overall": overall,
+            "commands": commands,
+        }
+
+
+class PipelinedBenchmark(HeadlessBenchmark):
+    """Keeps up to depth commands in flight and matches the replies in order.
+    Commands are written in bursts (e.g. ":GR#:GD#" in one USB write), commands
+    without a reply only take part in the schedule."""
+
+    def __init__(self, port, baudrate=115200, timeout=2.0, depth=4, burst=2):
+        super().__init__(port, baudrate, timeout)
+        self.depth = depth
+        self.burst = burst
+        self.in_flight = []         # (command, kind, send_ns), oldest first
+        self.lock = threading.Condition()
+        self.buffer = b""
+        self.running = False
+
+    def _take_reply(self, kind):
+        """Complete reply at the start of the buffer or None"""
+        if not self.buffer:
+            return None
+        if kind == REPLY_CHAR or (kind == REPLY_GOTO and self.buffer[:1] == b"0"):
+            return self.buffer[:1]
+        end = self.buffer.find(b"#")
+        return self.buffer[:end + 1] if end >= 0 else None
+
+    def _expire(self, now_ns):
+        """Replies not received in time are counted as timeouts (called with the lock)"""
+        timeout_ns = int(self.timeout * 1e9)
+        while self.in_flight and now_ns - self.in_flight[0][2] > timeout_ns:
+            command, _, _ = self.in_flight.pop(0)
+            self._command_stats(command)["timeouts"] += 1
+            self.lock.notify_all()
+
+    def _reader(self):
+        connection = self.serial_connection
+        connection.timeout = 0.001
+        while self.running:
+            data = connection.read(max(1, connection.in_waiting))
+            now_ns = time.perf_counter_ns()
+            with self.lock:
+                if data:
+                    if not self.in_flight:
+                        self.stray_bytes += len(data)
+                    else:
+                        self.buffer += data
+                while self.in_flight:
+                    command, kind, send_ns = self.in_flight[0]
+                    reply = self._take_reply(kind)
+                    if reply is None:
+                        break
+                    self.buffer = self.buffer[len(reply):]
+                    self.in_flight.pop(0)
+                    stats = self._command_stats(command)
+                    if self._reply_ok(command, kind, reply):
+                        stats["replies"] += 1
+                        stats["latency_ns"].append(now_ns - send_ns)
+                    else:
+                        stats["errors"] += 1
+                    self.lock.notify_all()
+                self._expire(now_ns)
+                if not self.in_flight and self.buffer:
+                    self.stray_bytes += len(self.buffer)
+                    self.buffer = b""
+
+    def run(self, mix, rate, count=None, duration=None, seed=None):
+        """rate: commands per second, sent in bursts of self.burst commands"""
+        import random
+        rng = random.Random(seed)
+        commands = [command for command, _ in mix]
+        weights = [weight for _, weight in mix]
+        interval_ns = int(1e9 * self.burst / rate) if rate > 0 else 0
+        late = 0
+        sent = 0
+
+        self.stats = {}
+        self.stray_bytes = 0
+        self.serial_connection.reset_input_buffer()
+        self.running = True
+        reader = threading.Thread(target=self._reader, daemon=True)
+        reader.start()
+
+        start_ns = time.perf_counter_ns()
+        index = 0
+        while True:
+            now_ns = time.perf_counter_ns()
+            if count is not None and sent >= count:
+                break
+            if duration is not None and now_ns - start_ns >= duration * 1e9:
+                break
+
+            due_ns = start_ns + index * interval_ns
+            if due_ns > now_ns:
+                time.sleep((due_ns - now_ns) / 1e9)
+            elif interval_ns and now_ns - due_ns > interval_ns:
+                late += 1
+
+            batch = [rng.choices(commands, weights)[0] for _ in range(self.burst)]
+            expecting = sum(1 for command in batch if reply_kind(command) != REPLY_NONE)
+            with self.lock:
+                # wait for room in the pipeline
+                while len(self.in_flight) + expecting > max(self.depth, expecting):
+                    self.lock.wait(0.01)
+                    self._expire(time.perf_counter_ns())
+                send_ns = time.perf_counter_ns()
+                self.serial_connection.write("".join(batch).encode("latin-1"))
+                for command in batch:
+                    self._command_stats(command)["sent"] += 1
+                    kind = reply_kind(command)
+                    if kind != REPLY_NONE:
+                        self.in_flight.append((command, kind, send_ns))
+            sent += len(batch)
+            index += 1
+
+        # outstanding replies
+        with self.lock:
+            while self.in_flight:
+                self.lock.wait(0.01)
+                self._expire(time.perf_counter_ns())
+        self.running = False
+        reader.join()
+
+        elapsed_ns = time.perf_counter_ns() - start_ns
+        result = self.report(rate, elapsed_ns, late)
+        result["depth"] = self.depth
+        result["burst"] = self.burst
+        return result
+
+
+def find_max_rate(bench, mix, rates, duration, seed):
+    """Runs the rates in order, the last rate reached without a timeout or error
+    is sustainable (a full pipeline holds the sender back, the rate is not reached)"""
+    steps = []
+    sustainable = None
+    for rate in rates:
+        result = bench.run(mix, rate, duration=duration, seed=seed)
+        overall = result["overall"]
+        ok = (overall["timeouts"] == 0 and overall["errors"] == 0 and overall["replies"] > 0
+              and result["throughput_cps"] >= 0.95 * rate)
+        steps.append({"rate": rate, "throughput_cps": result["throughput_cps"], "late": result["late"],
+                      "timeouts": overall["timeouts"], "errors": overall["errors"], "p99_us": overall["p99_us"]})
+        if not ok:
+            break
+        sustainable = result["throughput_cps"]
+    return {"max_sustainable_cps": sustainable, "steps": steps}
+
+
+def compare_baseline(result, baseline, tolerance_pct, slack_us):
+    """Regressions against a stored result: latency percentiles and timeout / error counts"""
+    regressions = []
+    limit = 1.0 + tolerance_pct / 100.0
+
+    for command, current in result["commands"].items():
+        reference = baseline.get("commands", {}).get(command)
+        if reference is None:
+            continue
+        for key in ("p50_us", "p99_us"):
+            if current[key] is None or reference.get(key) is None:
+                continue
+            if current[key] > reference[key] * limit + slack_us:
+                regressions.append(f"{command} {key}: {current[key]} us, baseline {reference[key]} us")
+
+    for key in ("timeouts", "errors"):
+        reference = baseline.get("overall", {}).get(key, 0)
+        if result["overall"][key] > reference:
+            regressions.append(f"{key}: {result['overall'][key]}, baseline {reference}")
+    return regressions
+
+
+def run_headless(args):
+    mix = parse_mix(args.mix)
+    if args.pipeline > 1:
+        bench = PipelinedBenchmark(args.port, args.baud, args.timeout_ms / 1000.0, args.pipeline, args.burst)
+    else:
+        bench = HeadlessBenchmark(args.port, args.baud, args.timeout_ms / 1000.0)
+    try:
+        if args.ramp:
+            start, stop, step = (float(value) for value in args.ramp.split(":"))
+            rates = [start + i * step for i in range(int((stop - start) / step) + 1)]
+            result = find_max_rate(bench, mix, rates, args.duration, args.seed)
+        else:
+            result = bench.run(mix, args.rate, count=args.count, duration=args.duration, seed=args.seed)
+    finally:
+        bench.close()
+    result["port"] = args.port
+    result["mix"] = args.mix
+
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+    if args.baseline and not args.ramp:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare_baseline(result, baseline, args.tolerance_pct, args.slack_us)
+        for regression in regressions:
+            print(f"REGRESSION: {regression}", file=sys.stderr)
+        if regressions:
+            return 1
+    return 0
+
+
 def main():
+    parser = argparse.ArgumentParser(description="LX200 Protocol Test Client")
+    parser.add_argument("--bench", action="store_true", help="headless benchmark instead of the GUI")
+    parser.add_argument("--port", help="serial port, e.g. COM11 or /tmp/lx200")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--mix", default=DEFAULT_MIX, help="weighted commands, e.g. ':GR#=4,:GD#=4,:Mgn0100#=1'")
+    parser.add_argument("--rate", type=float, default=10.0, help="target commands per second")
+    parser.add_argument("--count", type=int, help="number of commands")
+    parser.add_argument("--duration", type=float, help="run time in seconds (default 10 without --count)")
+    parser.add_argument("--timeout-ms", type=float, default=2000.0, help="reply timeout")
+    parser.add_argument("--pipeline", type=int, default=1, help="commands in flight (1: wait for each reply)")
+    parser.add_argument("--burst", type=int, default=2, help="commands per write in pipelined mode")
+    parser.add_argument("--ramp", help="start:stop:step rates, reports the maximum sustainable rate")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the command order")
+    parser.add_argument("--output", help="JSON result file (default stdout)")
+    parser.add_argument("--baseline", help="JSON result to compare with, exit code 1 on regression")
+    parser.add_argument("--tolerance-pct", type=float, default=20.0, help="allowed latency increase")
+    parser.add_argument("--slack-us", type=float, default=200.0, help="allowed absolute latency increase")
+    args = parser.parse_args()
+
+    if args.bench:
+        if not args.port:
+            parser.error("--bench needs --port")
+        if args.count is None and args.duration is None:
+            args.duration = 10.0
+        if args.ramp and args.duration is None:
+            parser.error("--ramp needs --duration per step")
+        sys.exit(run_headless(args))
+
+    if tk is None:
+        parser.error("tkinter is not available, use --bench")
     root = tk.Tk()
     app = LX200TestClient(root)
     root.mainloop()
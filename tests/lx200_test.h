@@ -0,0 +1,51 @@
+/*
+ ******************************************************************************
+ * @file    lx200_test.h
+ * @brief   Minimal unit test helpers for the host build
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+#ifndef LX200_TEST_H
+#define LX200_TEST_H
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdint.h>
+#include <string.h>
+
+/* ============================================================================
+ *                         PUBLIC DEFINES
+ * ============================================================================ */
+/* a failed check ends the test case */
+#define TEST_CHECK(condition) \
+    do { if(!(condition)) { test_fail(__FILE__, __LINE__, #condition); return; } } while(0)
+
+#define TEST_CHECK_STR(actual, expected) \
+    do { if(strcmp((actual), (expected)) != 0) { test_fail_str(__FILE__, __LINE__, (actual), (expected)); return; } } while(0)
+
+#define TEST_RUN(test) test_run(#test, test)
+
+/* ============================================================================
+ *                         PUBLIC FUNCTION PROTOTYPES
+ * ============================================================================ */
+
+void test_run(const char* name, void (*test)(void));
+void test_fail(const char* file, int line, const char* condition);
+void test_fail_str(const char* file, int line, const char* actual, const char* expected);
+
+/* sends a command via USB and runs the main loop, returns the USB output */
+const char* test_command(const char* command, uint32_t run_ms);
+/* runs the main loop until everything is settled (replies, caches expired) */
+void test_settle(void);
+
+/* suites */
+void test_spsc(void);
+void test_parser(void);
+void test_fs2(void);
+void test_st4(void);
+void test_config(void);
+
+#endif // LX200_TEST_H
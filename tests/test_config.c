@@ -0,0 +1,210 @@
+/*
+ ******************************************************************************
+ * @file    test_config.c
+ * @brief   Tests of the configuration store on the fake flash
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * config_init() is called again to simulate a reset, the fake flash keeps
+ * its content.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include "fake_hal.h"
+#include "fake_fs2.h"
+#include "host_board.h"
+#include "config_store.h"
+#include "mount_cache.h"
+#include "lx200_test.h"
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    unsigned generation;
+    unsigned used;
+    unsigned long writes;
+    unsigned long deferred;
+    unsigned long errors;
+} store_stats_t;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static int store_stats(store_stats_t* stats)
+{
+    return sscanf(test_command(":XC#", 1), "%*[^,],%*[^,],%*[^,],%u,%u,%lu,%lu,%lu", &stats->generation,
+                  &stats->used, &stats->writes, &stats->deferred, &stats->errors) == 5;
+}
+
+/* the write task is due CONFIG_WRITE_DELAY_MS after the last change */
+static void run_write_delay(void)
+{
+    host_board_run_ms(CONFIG_WRITE_DELAY_MS + 200);
+}
+
+static void set_and_get(void)
+{
+    test_settle();
+
+    TEST_CHECK_STR(test_command(":St-33*52#", 5), "1");
+    TEST_CHECK_STR(test_command(":Gt#", 5), "-33*52#");
+    TEST_CHECK_STR(test_command(":SMBackyard Obs#", 5), "1");
+    TEST_CHECK_STR(test_command(":GM#", 5), "Backyard Obs#");
+    TEST_CHECK(config_pending() != 0);
+
+    // the FS2 never sees them
+    TEST_CHECK(fake_fs2_count(":St-33*52#") == 0);
+}
+
+static void invalid_rejected(void)
+{
+    test_settle();
+
+    TEST_CHECK_STR(test_command(":St47*59#", 5), "0");
+    TEST_CHECK_STR(test_command(":Sg+007*5#", 5), "0");
+    TEST_CHECK_STR(test_command(":ST60.12#", 5), "0");
+    TEST_CHECK_STR(test_command(":SMThis name is far too long#", 5), "0");
+    // ',' separates the :XC# fields
+    TEST_CHECK_STR(test_command(":SMa,b#", 5), "0");
+}
+
+static void batch_survives_reset(void)
+{
+    store_stats_t before;
+    store_stats_t after;
+
+    test_settle();
+    run_write_delay();
+    TEST_CHECK(store_stats(&before));
+
+    TEST_CHECK_STR(test_command(":Sg 011*34#", 5), "1");
+    TEST_CHECK_STR(test_command(":ST59.9#", 5), "1");
+    // unchanged, no record
+    TEST_CHECK_STR(test_command(":ST59.9#", 5), "1");
+    TEST_CHECK(config_pending() != 0);
+
+    run_write_delay();
+    TEST_CHECK(config_pending() == 0);
+    TEST_CHECK(store_stats(&after));
+    TEST_CHECK(after.writes == before.writes + 2);
+
+    config_init();
+    TEST_CHECK_STR(test_command(":Gg#", 5), "011*34#");
+    TEST_CHECK_STR(test_command(":GT#", 5), "59.9#");
+}
+
+static void write_waits_for_guiding(void)
+{
+    store_stats_t stats;
+
+    test_settle();
+    TEST_CHECK_STR(test_command(":ST58.0#:Mgn3000#", 5), "1");
+
+    // due while the pulse is active, deferred until it ended
+    run_write_delay();
+    TEST_CHECK(config_pending() != 0);
+    host_board_run_ms(1000);
+    TEST_CHECK(config_pending() == 0);
+    TEST_CHECK(store_stats(&stats));
+    TEST_CHECK(stats.deferred > 0);
+}
+
+static void cut_record_skipped(void)
+{
+    test_settle();
+    TEST_CHECK_STR(test_command(":St+12*00#", 5), "1");
+    run_write_delay();
+
+    // power fails after the first value halfwords of the next record
+    TEST_CHECK_STR(test_command(":St+13*00#", 5), "1");
+    fake_flash_cut_after(2);
+    run_write_delay();
+    fake_flash_cut_after(UINT32_MAX);
+
+    config_init();
+    TEST_CHECK_STR(test_command(":Gt#", 5), "+12*00#");
+
+    // the slot of the cut record stays unused
+    TEST_CHECK_STR(test_command(":St+14*00#", 5), "1");
+    run_write_delay();
+    config_init();
+    TEST_CHECK_STR(test_command(":Gt#", 5), "+14*00#");
+}
+
+static void full_page_transferred(void)
+{
+    store_stats_t before;
+    store_stats_t after;
+    uint32_t erases = fake_flash_erase_count();
+
+    test_settle();
+    TEST_CHECK(store_stats(&before));
+
+    // more changes than records per page
+    for(uint8_t i = 0; i < 60; i++)
+    {
+        char rate[5] = { '5', (char)('0' + i % 10), '.', (char)('0' + i / 10), '\0' };
+
+        TEST_CHECK(config_set(CONFIG_TRACKING_RATE, rate, 4));
+        run_write_delay();
+        TEST_CHECK(config_pending() == 0);
+    }
+
+    TEST_CHECK(store_stats(&after));
+    TEST_CHECK(after.generation == before.generation + 1);
+    TEST_CHECK(after.errors == 0);
+    TEST_CHECK(fake_flash_erase_count() == erases + 1);
+
+    config_init();
+    TEST_CHECK_STR(test_command(":GT#", 5), "59.5#");
+    TEST_CHECK_STR(test_command(":Gt#", 5), "+14*00#");
+}
+
+static void defaults_restored(void)
+{
+    test_settle();
+
+    TEST_CHECK_STR(test_command(":XCD#", 5), "1");
+    TEST_CHECK_STR(test_command(":XCT61.0#", 5), "1");
+    run_write_delay();
+    config_init();
+    TEST_CHECK_STR(test_command(":GM#", 5), "LX200 Site#");
+    TEST_CHECK_STR(test_command(":Gt#", 5), "+47*59:46#");
+    TEST_CHECK_STR(test_command(":GT#", 5), "61.0#");
+}
+
+static void answers_keep_order(void)
+{
+    test_settle();
+    TEST_CHECK_STR(test_command(":XCD#", 5), "1");
+    mount_cache_invalidate();
+
+    // local answers wait for the reply of the forwarded :GD#
+    TEST_CHECK_STR(test_command(":GD#:St+48*00#", 30), "-05*23:28#1");
+    mount_cache_invalidate();
+    TEST_CHECK_STR(test_command(":GD#:GM#", 30), "-05*23:28#LX200 Site#");
+    mount_cache_invalidate();
+    TEST_CHECK_STR(test_command(":GD#:XCD#:Gt#", 30), "-05*23:28#1+47*59:46#");
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void test_config(void)
+{
+    TEST_RUN(set_and_get);
+    TEST_RUN(invalid_rejected);
+    TEST_RUN(batch_survives_reset);
+    TEST_RUN(write_waits_for_guiding);
+    TEST_RUN(cut_record_skipped);
+    TEST_RUN(full_page_transferred);
+    TEST_RUN(defaults_restored);
+    TEST_RUN(answers_keep_order);
+}
@@ -0,0 +1,344 @@
+/*
+ ******************************************************************************
+ * @file    test_fs2.c
+ * @brief   Tests of the FS2 adapter against the scripted FS2 mount
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <string.h>
+#include "fake_hal.h"
+#include "fake_fs2.h"
+#include "host_board.h"
+#include "mount_cache.h"
+#include "mount_reply.h"
+#include "mount_poller.h"
+#include "event_loop.h"
+#include "perf_counter.h"
+#include "scheduler.h"
+#include "lx200_latency.h"
+#include "lx200_test.h"
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static uint32_t slow_task_runs = 0;
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static void slow_task(void* context)
+{
+    slow_task_runs++;
+    fake_hal_advance_us(50);
+}
+
+static const sched_task_t slow_task_def = { "slow", slow_task, 10, 20 };
+
+static void position_forwarded_and_cached(void)
+{
+    test_settle();
+    mount_cache_invalidate();
+    fake_fs2_clear_counts();
+
+    TEST_CHECK_STR(test_command(":GR#", 30), "05:35:17#");
+    TEST_CHECK(fake_fs2_count(":GR#") == 1);
+
+    // second poll within MOUNT_CACHE_MAX_AGE_MS is answered by the proxy
+    TEST_CHECK_STR(test_command(":GR#", 2), "05:35:17#");
+    TEST_CHECK(fake_fs2_count(":GR#") == 1);
+}
+
+static void dec_reply_relayed(void)
+{
+    test_settle();
+    mount_cache_invalidate();
+
+    TEST_CHECK_STR(test_command(":GD#", 30), "-05*23:28#");
+}
+
+static void cached_reply_keeps_order(void)
+{
+    test_settle();
+    mount_cache_invalidate();
+    mount_cache_update_ra("05:35:17#", mount_cache_generation());
+    fake_fs2_clear_counts();
+
+    // RA is fresh, its answer waits behind the forwarded :GD#
+    TEST_CHECK_STR(test_command(":GD#:GR#", 30), "-05*23:28#05:35:17#");
+    TEST_CHECK(fake_fs2_count(":GR#") == 0);
+}
+
+static void ack_keeps_order(void)
+{
+    test_settle();
+    mount_cache_invalidate();
+
+    // the alignment query answer waits behind the forwarded :GD#
+    TEST_CHECK_STR(test_command(":GD#\x06", 30), "-05*23:28#G");
+}
+
+static void target_gets_space(void)
+{
+    test_settle();
+    fake_fs2_clear_counts();
+
+    TEST_CHECK_STR(test_command(":Sr05:40:00#", 30), "1");
+    TEST_CHECK(fake_fs2_count(":Sr 05:40:00#") == 1);
+
+    // unchanged target is acknowledged without the mount
+    TEST_CHECK_STR(test_command(":Sr05:40:00#", 2), "1");
+    TEST_CHECK(fake_fs2_count(":Sr") == 1);
+}
+
+static void target_keeps_order(void)
+{
+    test_settle();
+    TEST_CHECK_STR(test_command(":Sr05:40:00#", 30), "1");
+    mount_cache_invalidate();
+    fake_fs2_clear_counts();
+
+    // the local "1" must not overtake the reply of the forwarded :GD#
+    TEST_CHECK_STR(test_command(":GD#:Sr05:40:00#", 30), "-05*23:28#1");
+    TEST_CHECK(fake_fs2_count(":Sr") == 0);
+}
+
+static void dump_keeps_order(void)
+{
+    char expected[MOUNT_REPLY_LOCAL_MAX_LEN + 16];
+    const char* frame;
+
+    test_settle();
+    snprintf(expected, sizeof(expected), "-05*23:28#%s", test_command(":XR#", 2));
+
+    // the whole answer waits behind the forwarded :GD#
+    mount_cache_invalidate();
+    TEST_CHECK_STR(test_command(":GD#:XR#", 30), expected);
+
+    mount_cache_invalidate();
+    frame = test_command(":GD#:XT#", 30);
+    TEST_CHECK(strncmp(frame, "-05*23:28#", 10) == 0);
+    TEST_CHECK(strstr(frame, "rtt:60000,") != NULL);
+    TEST_CHECK(frame[strlen(frame) - 1] == '#');
+}
+
+static void full_local_queue_drops(void)
+{
+    uint32_t dropped = mount_reply_get_stats()->local_dropped;
+
+    test_settle();
+    mount_cache_invalidate();
+
+    // MOUNT_REPLY_LOCAL answers wait, the last one is dropped instead of overtaking
+    TEST_CHECK_STR(test_command(":GD#:GT#:GT#:GT#:GT#:GT#:GT#:GT#:GT#:GT#", 30),
+                   "-05*23:28#60.1#60.1#60.1#60.1#60.1#60.1#60.1#60.1#");
+    TEST_CHECK(mount_reply_get_stats()->local_dropped == dropped + 1);
+}
+
+static void latency_dump_bounded(void)
+{
+    const char* frame;
+
+    // every bucket of every row counted, the rows do not fit into one answer
+    for(uint8_t cls = 0; cls < LX200_LATENCY_CLASSES; cls++)
+    {
+        for(uint8_t b = 0; b < LX200_LATENCY_BUCKETS; b++)
+        {
+            for(uint8_t stage = 0; stage < LX200_STAGES; stage++)
+            {
+                lx200_timing_t timing = { .rx = 0, .dispatch = 0, .cls = cls, .valid = 1 };
+
+                lx200_latency_record(&timing, (lx200_stage_t)stage, (1UL << b) * (SystemCoreClock / 1000000U));
+            }
+        }
+    }
+
+    frame = test_command(":XH#", 2);
+    TEST_CHECK(strlen(frame) < MOUNT_REPLY_LOCAL_MAX_LEN);
+    TEST_CHECK(strcmp(&frame[strlen(frame) - 2], "+#") == 0);
+
+    frame = test_command(":XHU#", 2);
+    TEST_CHECK(strncmp(frame, "UQ:", 3) == 0);
+    TEST_CHECK(strcmp(&frame[strlen(frame) - 2], ";#") == 0);
+    TEST_CHECK_STR(test_command(":XHR#", 2), "1");
+}
+
+static void goto_sent_twice(void)
+{
+    test_settle();
+    fake_fs2_clear_counts();
+
+    TEST_CHECK_STR(test_command(":MS#", 30), "0");
+    TEST_CHECK(fake_fs2_count(":MS#") == 1);
+    host_board_run_ms(100);
+    TEST_CHECK(fake_fs2_count(":MS#") == 2);
+    // the reply of the second send is not passed to the client
+    TEST_CHECK_STR(fake_usb_output(), "0");
+}
+
+static void goto_repeat_cancelled(void)
+{
+    uint32_t rejected;
+
+    // a manual move right after :MS# drops its second send
+    test_settle();
+    fake_fs2_clear_counts();
+    TEST_CHECK_STR(test_command(":MS#", 30), "0");
+    test_command(":Mn#", 1);
+    host_board_run_ms(100);
+    TEST_CHECK(fake_fs2_count(":MS#") == 1);
+    test_command(":Qn#", 10);
+
+    // :MS# rejected, all pending entries in use: not sent later either
+    test_settle();
+    mount_cache_invalidate();
+    fake_fs2_clear_counts();
+    rejected = mount_reply_get_stats()->rejected;
+    test_command(":GD#:GD#:GD#:GD#:GD#:GD#:GD#:GD#:MS#", 200);
+    TEST_CHECK(mount_reply_get_stats()->rejected == rejected + 1);
+    TEST_CHECK(fake_fs2_count(":MS#") == 0);
+}
+
+static void timeout_without_reply(void)
+{
+    uint32_t timeouts = mount_reply_get_stats()->timeouts;
+
+    test_settle();
+    mount_cache_invalidate();
+    fake_fs2_set_silent(1);
+
+    TEST_CHECK_STR(test_command(":GD#", MOUNT_REPLY_TIMEOUT_MS + 100), "");
+    TEST_CHECK(mount_reply_get_stats()->timeouts > timeouts);
+
+    fake_fs2_set_silent(0);
+    test_settle();
+    mount_cache_invalidate();
+    TEST_CHECK_STR(test_command(":GD#", 30), "-05*23:28#");
+}
+
+static void statistics_frame(void)
+{
+    const char* frame = test_command(":XS#", 2);
+    uint32_t fields = 1;
+
+    for(const char* p = frame; *p != '\0'; p++)
+    {
+        fields += (*p == ',');
+    }
+    TEST_CHECK(fields == 20);
+    TEST_CHECK(frame[strlen(frame) - 1] == '#');
+}
+
+static void idle_loop_sleeps(void)
+{
+    const char* frame;
+    uint32_t passes;
+
+    test_settle();
+    passes = event_get_stats()->passes;
+
+    // only the background polls and their replies wake the loop
+    host_board_run_ms(1000);
+    TEST_CHECK(event_get_stats()->passes - passes < 100);
+    TEST_CHECK(event_get_stats()->idle_permille > 900);
+
+    // a USB packet is dispatched in the ms it arrives
+    frame = test_command(":XW#", 1);
+    TEST_CHECK(frame[strlen(frame) - 1] == '#');
+    TEST_CHECK(PERF_CYCLES_TO_US(event_get_stats()->latency_max_cycles) <= 1000);
+}
+
+static void task_table_listed(void)
+{
+    char expected[48];
+
+    test_settle();
+    TEST_CHECK(sched_start(&slow_task_def, 10, NULL));
+    host_board_run_ms(100);
+    sched_stop(&slow_task_def);
+    TEST_CHECK((slow_task_runs >= 9) && (slow_task_runs <= 10));
+
+    // every run took 50us with a budget of 20us
+    snprintf(expected, sizeof(expected), "slow:10,20,%lu,50,50,%lu,", (unsigned long)slow_task_runs,
+             (unsigned long)slow_task_runs);
+    const char* frame = test_command(":XT#", 2);
+    TEST_CHECK(strstr(frame, expected) != NULL);
+    TEST_CHECK(strstr(frame, "rtt:60000,") != NULL);
+}
+
+static void distance_given_up_sleeps(void)
+{
+    uint32_t passes;
+
+    // every poll times out, :D# is given up after 3 rounds of :GR# :GD# :D#
+    test_settle();
+    fake_fs2_set_silent(1);
+    host_board_run_ms(9 * MOUNT_REPLY_TIMEOUT_MS + 1000);
+    fake_fs2_set_silent(0);
+    test_settle();
+    fake_fs2_clear_counts();
+    passes = event_get_stats()->passes;
+
+    host_board_run_ms(3000);
+    TEST_CHECK(fake_fs2_count(":D#") == 0);
+    TEST_CHECK(fake_fs2_count(":GR#") > 0);
+    TEST_CHECK(event_get_stats()->passes - passes < 300);
+}
+
+static void distance_unknown_not_polled(void)
+{
+    // mount firmware without :D#, probed after a restart of the poller
+    test_settle();
+    fake_fs2_set_ignored(":D#");
+    fake_fs2_clear_counts();
+    mount_poller_init();
+    host_board_run_ms(MOUNT_POLL_QUIET_MS + 10);
+    TEST_CHECK(fake_fs2_count(":D#") == 1);
+
+    // the probe takes the reply of this command, :D# is given up at once
+    mount_cache_invalidate();
+    test_command(":GD#", MOUNT_REPLY_TIMEOUT_MS + 100);
+    TEST_CHECK(mount_poller_get_stats()->slewing == 0);
+
+    for(uint8_t i = 0; i < 10; i++)
+    {
+        host_board_run_ms(1600);
+        mount_cache_invalidate();
+        TEST_CHECK_STR(test_command(":GD#", 30), "-05*23:28#");
+    }
+    TEST_CHECK(fake_fs2_count(":D#") == 1);
+    TEST_CHECK(fake_fs2_count(":GR#") > 0);
+    fake_fs2_set_ignored(NULL);
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void test_fs2(void)
+{
+    TEST_RUN(position_forwarded_and_cached);
+    TEST_RUN(dec_reply_relayed);
+    TEST_RUN(cached_reply_keeps_order);
+    TEST_RUN(ack_keeps_order);
+    TEST_RUN(target_gets_space);
+    TEST_RUN(target_keeps_order);
+    TEST_RUN(dump_keeps_order);
+    TEST_RUN(full_local_queue_drops);
+    TEST_RUN(latency_dump_bounded);
+    TEST_RUN(goto_sent_twice);
+    TEST_RUN(goto_repeat_cancelled);
+    TEST_RUN(timeout_without_reply);
+    TEST_RUN(statistics_frame);
+    TEST_RUN(idle_loop_sleeps);
+    TEST_RUN(task_table_listed);
+    // last, :D# stays given up
+    TEST_RUN(distance_given_up_sleeps);
+    TEST_RUN(distance_unknown_not_polled);
+}
@@ -0,0 +1,103 @@
+/*
+ ******************************************************************************
+ * @file    test_main.c
+ * @brief   Unit test runner of the host build
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ *
+ * Usage: lx200_tests <suite>, every suite runs in its own process (ctest)
+ * because the application modules keep their state in static variables.
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include <stdio.h>
+#include <string.h>
+#include "fake_hal.h"
+#include "host_board.h"
+#include "lx200_test.h"
+
+/* ============================================================================
+ *                         PRIVATE TYPES
+ * ============================================================================ */
+typedef struct {
+    const char* name;
+    void (*run)(void);
+} suite_t;
+
+/* ============================================================================
+ *                         PRIVATE VARIABLES
+ * ============================================================================ */
+static const suite_t suites[] = {
+    { "spsc",   test_spsc },
+    { "parser", test_parser },
+    { "fs2",    test_fs2 },
+    { "st4",    test_st4 },
+    { "config", test_config },
+};
+
+static uint32_t tests_run = 0;
+static uint32_t tests_failed = 0;
+static uint8_t current_failed = 0;
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void test_run(const char* name, void (*test)(void))
+{
+    current_failed = 0;
+    test();
+    tests_run++;
+    if(current_failed)
+    {
+        tests_failed++;
+    }
+    printf("%s %s\n", current_failed ? "FAIL" : "ok  ", name);
+}
+
+void test_fail(const char* file, int line, const char* condition)
+{
+    current_failed = 1;
+    printf("  %s:%d: check failed: %s\n", file, line, condition);
+}
+
+void test_fail_str(const char* file, int line, const char* actual, const char* expected)
+{
+    current_failed = 1;
+    printf("  %s:%d: got \"%s\", expected \"%s\"\n", file, line, actual, expected);
+}
+
+const char* test_command(const char* command, uint32_t run_ms)
+{
+    fake_usb_clear();
+    fake_usb_receive(command);
+    host_board_run_ms(run_ms);
+    return fake_usb_output();
+}
+
+void test_settle(void)
+{
+    host_board_run_ms(2000);
+    fake_usb_clear();
+    fake_uart_clear();
+    fake_debug_clear();
+}
+
+int main(int argc, char** argv)
+{
+    host_board_init();
+
+    for(size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++)
+    {
+        if((argc < 2) || (strcmp(argv[1], suites[i].name) == 0))
+        {
+            suites[i].run();
+        }
+    }
+
+    printf("%lu tests, %lu failed\n", (unsigned long)tests_run, (unsigned long)tests_failed);
+    return ((tests_failed == 0) && (tests_run > 0)) ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/*
+ ******************************************************************************
+ * @file    test_parser.c
+ * @brief   Tests of the LX200 parser and USB receive queue
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include "fake_hal.h"
+#include "host_board.h"
+#include "lx200_server.h"
+#include "lx200_rewrite.h"
+#include "lx200_test.h"
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static void local_command(void)
+{
+    TEST_CHECK_STR(test_command(":GM#", 2), "LX200 Site#");
+}
+
+static void command_split_over_packets(void)
+{
+    uint32_t commands = GetLX200Stats()->commands;
+
+    fake_usb_clear();
+    fake_usb_receive(":G");
+    host_board_run_ms(2);
+    fake_usb_receive("t#");
+    host_board_run_ms(2);
+    TEST_CHECK_STR(fake_usb_output(), "+47*59:46#");
+    TEST_CHECK(GetLX200Stats()->commands == commands + 1);
+}
+
+static void garbage_between_commands(void)
+{
+    TEST_CHECK_STR(test_command("xx#:GM#yy:GT#", 2), "LX200 Site#60.1#");
+}
+
+static void ack_answered(void)
+{
+    TEST_CHECK_STR(test_command("\x06", 2), "G");
+}
+
+static void too_long_command_counted(void)
+{
+    char command[100];
+    uint32_t overflows = GetLX200Stats()->parser_overflows;
+
+    memset(command, 'x', sizeof(command) - 1);
+    command[0] = ':';
+    command[sizeof(command) - 2] = '#';
+    command[sizeof(command) - 1] = '\0';
+
+    test_command(command, 2);
+    TEST_CHECK(GetLX200Stats()->parser_overflows == overflows + 1);
+    // parser recovers with the next command
+    TEST_CHECK_STR(test_command(":GM#", 2), "LX200 Site#");
+}
+
+static void many_commands_in_one_burst(void)
+{
+    char burst[400] = "";
+    char expected[600] = "";
+
+    for(uint8_t i = 0; i < 40; i++)
+    {
+        strcat(burst, ":GM#");
+        strcat(expected, "LX200 Site#");
+    }
+    TEST_CHECK_STR(test_command(burst, 5), expected);
+    TEST_CHECK(GetLX200Stats()->queue_overflows == 0);
+}
+
+static void rewrite_rules(void)
+{
+    static const lx200_rule_t space = { LX200_RULE_INSERT, 3, 0, " ", 0 };
+    static const lx200_rule_t precision = { LX200_RULE_REPLACE, 1, 1, "P", 0 };
+    static const char with_space[] = ":Sr 05:40:00#";
+    char out[16];
+
+    TEST_CHECK_STR(lx200_rewrite_apply(&space, ":Sr05:40:00#", out, sizeof(out)), ":Sr 05:40:00#");
+    // inserted only once, the command is not copied
+    TEST_CHECK(lx200_rewrite_apply(&space, with_space, out, sizeof(out)) == with_space);
+    TEST_CHECK_STR(lx200_rewrite_apply(&precision, ":U#", out, sizeof(out)), ":P#");
+    // does not fit
+    TEST_CHECK(lx200_rewrite_apply(&space, ":Sd+10*00:00:00#", out, sizeof(out)) == NULL);
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void test_parser(void)
+{
+    TEST_RUN(local_command);
+    TEST_RUN(command_split_over_packets);
+    TEST_RUN(garbage_between_commands);
+    TEST_RUN(ack_answered);
+    TEST_RUN(too_long_command_counted);
+    TEST_RUN(many_commands_in_one_burst);
+    TEST_RUN(rewrite_rules);
+}
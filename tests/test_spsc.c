@@ -0,0 +1,80 @@
+/*
+ ******************************************************************************
+ * @file    test_spsc.c
+ * @brief   Tests of the single producer / single consumer queue
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include "spsc_queue.h"
+#include "lx200_test.h"
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static void push_pop_wraps(void)
+{
+    uint8_t storage[8];
+    uint8_t out[8];
+    spsc_queue_t q;
+
+    spsc_init(&q, storage, sizeof(storage));
+    for(uint8_t round = 0; round < 5; round++)
+    {
+        TEST_CHECK(spsc_push(&q, (const uint8_t*)"abcde", 5));
+        TEST_CHECK(spsc_used(&q) == 5);
+        TEST_CHECK(spsc_pop(&q, out, sizeof(out)) == 5);
+        TEST_CHECK(memcmp(out, "abcde", 5) == 0);
+    }
+    TEST_CHECK(spsc_used(&q) == 0);
+}
+
+static void push_is_all_or_nothing(void)
+{
+    uint8_t storage[8];
+    spsc_queue_t q;
+
+    spsc_init(&q, storage, sizeof(storage));
+    TEST_CHECK(spsc_push(&q, (const uint8_t*)"123456", 6));
+    TEST_CHECK(!spsc_push(&q, (const uint8_t*)"789", 3));
+    TEST_CHECK(spsc_used(&q) == 6);
+    TEST_CHECK(spsc_push(&q, (const uint8_t*)"78", 2));
+    TEST_CHECK(spsc_free(&q) == 0);
+}
+
+static void stamps_limit_to_block(void)
+{
+    uint8_t storage[16];
+    spsc_stamp_t stamp_storage[4];
+    spsc_queue_t q;
+    spsc_stamps_t s = { stamp_storage, 3, 0, 0 };
+    uint8_t out[16];
+    uint32_t cycles = 0;
+
+    spsc_init(&q, storage, sizeof(storage));
+    spsc_push(&q, (const uint8_t*)"abc", 3);
+    spsc_stamp(&s, &q, 100);
+    spsc_push(&q, (const uint8_t*)"de", 2);
+    spsc_stamp(&s, &q, 200);
+
+    TEST_CHECK(spsc_pop(&q, out, spsc_stamp_limit(&s, &q, sizeof(out), &cycles)) == 3);
+    TEST_CHECK(cycles == 100);
+    TEST_CHECK(spsc_pop(&q, out, spsc_stamp_limit(&s, &q, sizeof(out), &cycles)) == 2);
+    TEST_CHECK(cycles == 200);
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void test_spsc(void)
+{
+    TEST_RUN(push_pop_wraps);
+    TEST_RUN(push_is_all_or_nothing);
+    TEST_RUN(stamps_limit_to_block);
+}
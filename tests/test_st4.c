@@ -0,0 +1,244 @@
+/*
+ ******************************************************************************
+ * @file    test_st4.c
+ * @brief   Tests of the ST4 guide outputs
+ * @author  Sven Lissel
+ * @date    2025
+ ******************************************************************************
+ */
+
+/* ============================================================================
+ *                              INCLUDES
+ * ============================================================================ */
+#include "main.h"
+#include "fake_hal.h"
+#include "host_board.h"
+#include "st4_handler.h"
+#include "lx200_test.h"
+
+/* ============================================================================
+ *                         PRIVATE FUNCTIONS
+ * ============================================================================ */
+
+static uint8_t pin_active(uint16_t pin)
+{
+    return HAL_GPIO_ReadPin(ST4_PORT, pin) == GPIO_PIN_RESET;   // active low
+}
+
+static void guide_pulse_duration(void)
+{
+    uint32_t pulses = st4_get_pulses(ST4_NORTH);
+
+    test_command(":Mgn0300#", 1);
+    TEST_CHECK(pin_active(ST4_NORTH_Pin));
+    TEST_CHECK(!pin_active(ST4_SOUTH_Pin));
+    host_board_run_ms(295);
+    TEST_CHECK(pin_active(ST4_NORTH_Pin));
+    host_board_run_ms(10);
+    TEST_CHECK(!pin_active(ST4_NORTH_Pin));
+    TEST_CHECK(st4_get_pulses(ST4_NORTH) == pulses + 1);
+}
+
+static void axes_independent(void)
+{
+    test_command(":Mge0100#:Mgs0200#", 1);
+    TEST_CHECK(pin_active(ST4_EAST_Pin));
+    TEST_CHECK(pin_active(ST4_SOUTH_Pin));
+    host_board_run_ms(150);
+    TEST_CHECK(!pin_active(ST4_EAST_Pin));
+    TEST_CHECK(pin_active(ST4_SOUTH_Pin));
+    host_board_run_ms(100);
+    TEST_CHECK(!pin_active(ST4_SOUTH_Pin));
+}
+
+static void guide_without_reply(void)
+{
+    TEST_CHECK_STR(test_command(":Mgw0050#", 100), "");
+    TEST_CHECK(!pin_active(ST4_WEST_Pin));
+}
+
+static void short_pulse_exact(void)
+{
+    // edges come from the timer interrupt, not from the 1ms main loop
+    st4_set(ST4_NORTH, 50);
+    st4_commit();
+    TEST_CHECK(pin_active(ST4_NORTH_Pin));
+    fake_hal_advance_us(49990);
+    TEST_CHECK(pin_active(ST4_NORTH_Pin));
+    fake_hal_advance_us(20);
+    TEST_CHECK(!pin_active(ST4_NORTH_Pin));
+
+    // 0.1 ms steps
+    st4_pulse(ST4_EAST, 5);
+    st4_commit();
+    fake_hal_advance_us(490);
+    TEST_CHECK(pin_active(ST4_EAST_Pin));
+    fake_hal_advance_us(20);
+    TEST_CHECK(!pin_active(ST4_EAST_Pin));
+}
+
+static void long_pulse_in_steps(void)
+{
+    // longer than the 16 bit timer period
+    st4_set(ST4_SOUTH, 5000);
+    st4_commit();
+    host_board_run_ms(4999);
+    TEST_CHECK(pin_active(ST4_SOUTH_Pin));
+    fake_hal_advance_us(1010);
+    TEST_CHECK(!pin_active(ST4_SOUTH_Pin));
+}
+
+static void pulse_extended_and_stopped(void)
+{
+    st4_set(ST4_WEST, 100);
+    st4_commit();
+    fake_hal_advance_us(60000);
+    st4_set(ST4_WEST, 100);     // ends 100ms from now
+    st4_commit();
+    fake_hal_advance_us(90000);
+    TEST_CHECK(pin_active(ST4_WEST_Pin));
+    st4_pulse(ST4_WEST, 0);
+    st4_commit();
+    TEST_CHECK(!pin_active(ST4_WEST_Pin));
+}
+
+static void accuracy_reported(void)
+{
+    const ST4_Accuracy_t* accuracy = st4_get_accuracy();
+    uint32_t pulses = accuracy->pulses;
+
+    st4_set(ST4_NORTH, 20);
+    st4_commit();
+    host_board_run_ms(30);
+    TEST_CHECK(accuracy->pulses == pulses + 1);
+    TEST_CHECK((accuracy->max_error_us <= 1) && (accuracy->min_error_us >= -1));
+    TEST_CHECK(strchr(test_command(":XA#", 1), '#') != NULL);
+}
+
+static void edges_committed_together(void)
+{
+    // staged until the commit, then RA and Dec in the same write
+    st4_set(ST4_NORTH, 100);
+    st4_set(ST4_WEST, 100);
+    TEST_CHECK(!pin_active(ST4_NORTH_Pin));
+    TEST_CHECK(!pin_active(ST4_WEST_Pin));
+    st4_commit();
+    TEST_CHECK(pin_active(ST4_NORTH_Pin));
+    TEST_CHECK(pin_active(ST4_WEST_Pin));
+
+    // both compares start on the same counter value and end together
+    fake_hal_advance_us(99999);
+    TEST_CHECK(pin_active(ST4_NORTH_Pin) && pin_active(ST4_WEST_Pin));
+    fake_hal_advance_us(2);
+    TEST_CHECK(!pin_active(ST4_NORTH_Pin) && !pin_active(ST4_WEST_Pin));
+
+    // a pulse stopped before the commit never reaches the pin
+    st4_set(ST4_EAST, 100);
+    st4_pulse(ST4_EAST, 0);
+    st4_commit();
+    TEST_CHECK(!pin_active(ST4_EAST_Pin));
+}
+
+static void opposite_cancelled(void)
+{
+    st4_set(ST4_NORTH, 500);
+    st4_commit();
+    fake_hal_advance_us(100000);
+    st4_set(ST4_SOUTH, 100);
+    st4_commit();
+    // never both directions of an axis
+    TEST_CHECK(!pin_active(ST4_NORTH_Pin));
+    TEST_CHECK(pin_active(ST4_SOUTH_Pin));
+    fake_hal_advance_us(100100);
+    TEST_CHECK(!pin_active(ST4_SOUTH_Pin));
+    TEST_CHECK(!pin_active(ST4_NORTH_Pin));
+}
+
+static void opposite_netted(void)
+{
+    st4_set_policy(ST4_POLICY_REPLACE, ST4_OPPOSING_NET);
+
+    st4_set(ST4_NORTH, 500);
+    st4_commit();
+    fake_hal_advance_us(100000);
+    st4_set(ST4_SOUTH, 100);        // 400ms left - 100ms
+    st4_commit();
+    TEST_CHECK(pin_active(ST4_NORTH_Pin));
+    TEST_CHECK(!pin_active(ST4_SOUTH_Pin));
+    fake_hal_advance_us(299000);
+    TEST_CHECK(pin_active(ST4_NORTH_Pin));
+    fake_hal_advance_us(2000);
+    TEST_CHECK(!pin_active(ST4_NORTH_Pin));
+
+    st4_set(ST4_EAST, 100);
+    st4_commit();
+    st4_set(ST4_WEST, 300);         // west for the difference
+    st4_commit();
+    TEST_CHECK(!pin_active(ST4_EAST_Pin));
+    TEST_CHECK(pin_active(ST4_WEST_Pin));
+    fake_hal_advance_us(201000);
+    TEST_CHECK(!pin_active(ST4_WEST_Pin));
+
+    st4_set_policy(ST4_POLICY_REPLACE, ST4_OPPOSING_CANCEL);
+}
+
+static void same_direction_extended(void)
+{
+    st4_set_policy(ST4_POLICY_EXTEND, ST4_OPPOSING_CANCEL);
+
+    st4_set(ST4_EAST, 100);
+    st4_commit();
+    fake_hal_advance_us(50000);
+    st4_set(ST4_EAST, 100);         // 50ms left + 100ms
+    st4_commit();
+    fake_hal_advance_us(149000);
+    TEST_CHECK(pin_active(ST4_EAST_Pin));
+    fake_hal_advance_us(2000);
+    TEST_CHECK(!pin_active(ST4_EAST_Pin));
+
+    st4_set_policy(ST4_POLICY_REPLACE, ST4_OPPOSING_CANCEL);
+}
+
+static void same_direction_queued(void)
+{
+    const ST4_Guide_Stats_t* stats = st4_get_guide_stats();
+    uint32_t dropped = stats->dropped;
+
+    TEST_CHECK(strncmp(test_command(":XGQ#", 1), "Q,C,0,0,", 8) == 0);
+    for(uint8_t i = 0; i < 6; i++)
+    {
+        st4_set(ST4_WEST, 100);
+        st4_commit();
+    }
+    TEST_CHECK(st4_queue_depth(ST4_AXIS_RA) == ST4_QUEUE_DEPTH);
+    TEST_CHECK(stats->dropped == dropped + 1);
+
+    // 5 pulses back to back
+    fake_hal_advance_us(499000);
+    TEST_CHECK(pin_active(ST4_WEST_Pin));
+    TEST_CHECK(st4_queue_depth(ST4_AXIS_RA) == 0);
+    fake_hal_advance_us(2000);
+    TEST_CHECK(!pin_active(ST4_WEST_Pin));
+
+    TEST_CHECK(test_command(":XGRC#", 1)[0] == 'R');
+}
+
+/* ============================================================================
+ *                         PUBLIC FUNCTIONS
+ * ============================================================================ */
+
+void test_st4(void)
+{
+    TEST_RUN(guide_pulse_duration);
+    TEST_RUN(axes_independent);
+    TEST_RUN(guide_without_reply);
+    TEST_RUN(short_pulse_exact);
+    TEST_RUN(long_pulse_in_steps);
+    TEST_RUN(pulse_extended_and_stopped);
+    TEST_RUN(same_direction_queued);
+    TEST_RUN(accuracy_reported);
+    TEST_RUN(edges_committed_together);
+    TEST_RUN(opposite_cancelled);
+    TEST_RUN(opposite_netted);
+    TEST_RUN(same_direction_extended);
+}